@@ -0,0 +1,12 @@
+#ifndef AMBI_MACS_CONFIG_H
+#define AMBI_MACS_CONFIG_H
+
+// QMK reads the matrix debounce from config.h, not rules.mk. Take it from
+// the Makefile's DEBOUNCE, which OPT_DEFS passes as KEYMAP_DEBOUNCE, so the
+// firmware debounces as the simulator does.
+#ifdef KEYMAP_DEBOUNCE
+#undef DEBOUNCE
+#define DEBOUNCE KEYMAP_DEBOUNCE
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef AMBI_MACS_CUSTOM_KEYCODES_H
+#define AMBI_MACS_CUSTOM_KEYCODES_H
+
+// Keycodes handled in process_record_user. Kept apart from keymap.c so
+// sim/sparse_layers can read sparse_layers.def without the rest of it.
+enum custom_keycodes {
+  PLACEHOLDER = SAFE_RANGE, // sets enum to safe range for custom keycodes. Must be at top
+  EPRM,
+  VRSN,
+  RGB_SLD,
+  STAT,
+  TRCE,
+  TUNE,
+  TUNE_UP,
+  TUNE_DN,
+  DM_REC,
+  DM_PLAY,
+  // Cadet keycodes must stay contiguous; they index straight into cadets[] in keymap.c
+  KC_LCCO,
+  KC_RCCC,
+  KC_LCBO,
+  KC_RCBC,
+  KC_LCFS,
+  KC_RCBS,
+  KC_LCAO,
+  KC_RCAC,
+  // Dance keycodes must stay contiguous; they index straight into dances[] in keymap.c
+  TD_X_QUOT,
+  TD_V_MINS
+};
+
+#endif
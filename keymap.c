@@ -3,13 +3,13 @@
 #include "action_layer.h"
 #include "version.h"
 #include "action_macro.h"
-
-#define BASE 0 // default layer
-#define ALPH 1 // alpha layer
-#define MDIA 2 // media layer
-#define SYMB 3 // symbols (unused)
-#define NAV 4 // nav layer with OS+Emacs bindings
-#define FN 5 // varous FNs
+#include "layers.h"
+#include "custom_keycodes.h"
+#include "eeprom.h"
+#ifdef RAW_ENABLE
+#include "raw_hid.h"
+#include "overlay.h"
+#endif
 
 // Extra Space-Cadet shifts. Ref: https://docs.qmk.fm/space_cadet_shift.html
 // KC_LEFT_CURLY_BRACE
@@ -27,13 +27,13 @@
   #define RCBC_KEY KC_RBRACKET
 #endif
 // KC_LEFT_ANGLE_BRACKET
-//#ifndef LCAO_KEY // Left Cadet Left Angle Open, <
-//  #define LCAO_KEY KC_COMM // note: not actual anglebrace, must be used with shift mod to get <>
-//#endif
+#ifndef LCAO_KEY // Left Cadet Left Angle Open, LCmd / <
+  #define LCAO_KEY KC_COMM // note: not actual anglebrace, must be used with shift mod to get <>
+#endif
 // KC_RIGHT_ANGLE_BRACKET
-//#ifndef RCAC_KEY // Right Cadet Right Angle Close, >
-//  #define RCAC_KEY KC_DOT
-//#endif
+#ifndef RCAC_KEY // Right Cadet Right Angle Close, RCmd / >
+  #define RCAC_KEY KC_DOT
+#endif
 // KC_LEFT_FORWARD_SLASH
 #ifndef LCFS_KEY // Left Cadet Foward Slash, LCmd / `/`
   #define LCFS_KEY KC_SLSH
@@ -50,38 +50,15 @@
 #define M_WLEFT M(1) // Window to left display
 #define M_WRGHT M(2) // Window to right display
 
-enum custom_keycodes {
-  PLACEHOLDER = SAFE_RANGE, // sets enum to safe range for custom keycodes. Must be at top
-  EPRM,
-  VRSN,
-  RGB_SLD,
-  KC_LCCO,
-  KC_RCCC,
-  KC_LCBO,
-  KC_RCBC,
-  KC_LCFS,
-  KC_RCBS
-  //KC_LCAO,
-  //KC_RCAC
-};
-
-//Tap Dance Declarations
-enum {
-  TD_X_QUOT = 0,
-  TD_V_MINS = 1
-};
-
-//Tap Dance Definitions
-/*qk_tap_dance_action_t tap_dance_actions[] = {
-  //Tap once for Esc, twice for Caps Lock
-  [TD_X_QUOT]  = ACTION_TAP_DANCE_DOUBLE(KC_X, KC_QUOT),
-  [TD_V_MINS]  = ACTION_TAP_DANCE_DOUBLE(KC_V, KC_MINS)
-// Other declarations would go here, separated by commas, if you have them
-};*/
+// Cadet keycodes are in custom_keycodes.h
+#define CADET_FIRST KC_LCCO
+#define CADET_LAST KC_RCAC
+#define CADET_COUNT (CADET_LAST - CADET_FIRST + 1)
 
-//In Layer declaration, add tap dance item in place of a key code
-//TD(TD_X_QUOT)
-//TD(TD_V_MINS)
+// Dance keycodes are in custom_keycodes.h too
+#define DANCE_FIRST TD_X_QUOT
+#define DANCE_LAST TD_V_MINS
+#define DANCE_COUNT (DANCE_LAST - DANCE_FIRST + 1)
 
 /*  TODO: M-x forward-sexp (along with backward, down, and up) would be good to have on right hand
           Create "hold backspace" layer on left hand for NAV
@@ -94,13 +71,15 @@ Also install https://github.com/purcell/exec-path-from-shell to ensure consisten
 
 // TODO: make "hold LEAD" into another alpha shift? (is this the best use of it?)
 // TODO: Get = hittable for the love of god. and what about backtick/tilde
-// TODO: better mousekeys support? https://docs.qmk.fm/mouse_keys.html
-// TODO: double tap Z, X for " and -? might be better to leave Z as punctuation shift tho
-//       ref: https://docs.qmk.fm/tap_dance.html
+// TODO: double tap Z? might be better to leave Z as punctuation shift tho
 // TODO: more useful double taps? Y, and the punctuation on the bottom right ergodox could be repurposed?
 // TODO: maybe just use the current planned "HYPER" (on backspace) to instead be "Hold Z"
 //       it would be easy to make movement buttons that are ergonomic on ergodox & otherwise (using ESDF)
 
+// keymaps[] only holds BASE. ALPH is derived from it and the mostly
+// transparent layers are packed from sparse_layers.def; anything else (FN)
+// is transparent. keymap_key_to_keycode() below sorts this out.
+
 // Ref: https://docs.qmk.fm/quantum_keycodes.html
 const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 /* Keymap 0: Basic layer
@@ -111,12 +90,12 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
  * | LAlt/[ |   Q  |   W  |   E  |   R  |   T  | Tab  |           |  -   |   Y  |   U  |   I  |   O  |   P  | RAlt/] |
  * |--------+------+------+------+------+------|/ALPH |           |      |------+------+------+------+------+--------|
  * | LCtrl/{|   A  |   S  |   D  |   F  |   G  |------|           |------|   H  |   J  |   K  |   L  |   ;  | RCtrl/}|
- * |--------+------+------+------+------+------| LCmd |           | RCmd |------+------+------+------+------+--------|
- * |LShift/(|Z/SYMB|   X  |   C  |   V  |B/SYMB|      |           |      |   N  |   M  |   ,  |   .  |   /  |RShift/)|
+ * |--------+------+------+------+------+------|LCmd/<|           |RCmd/>|------+------+------+------+------+--------|
+ * |LShift/(|Z/SYMB|X 2x' |   C  |V 2x- |B/SYMB|      |           |      |   N  |   M  |   ,  |   .  |   /  |RShift/)|
  * `--------+------+------+------+------+-------------'           `-------------+------+------+------+------+--------'
  *   |LCmd//| LEAD |O_ALPH| Left | Right|                                       | Down |  Up  |   \  |   `  |RCmd/\|
  *   `----------------------------------'                                       `----------------------------------'
- * TODO: implement the LCmd/< and RCmd/>
+ * 2x: double tap for the second key, see TAP DANCE below
  *                                        ,-------------.       ,---------------.
  *                                        |      |      |       |      |        |
  *                                 ,------|------|------|       |------+--------+------.
@@ -132,7 +111,7 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
           KC_LT,        KC_1,         KC_2,   KC_3,   KC_4,   KC_5,      KC_LEAD,
         KC_LCBO,        KC_Q,         KC_W,   KC_E,   KC_R,   KC_T,      LT(ALPH, KC_TAB),
         KC_LCCO,        KC_A,         KC_S,   KC_D,   KC_F,   KC_G,
-        KC_LSPO,LT(SYMB,KC_Z),        KC_X,   KC_C,   KC_V,LT(SYMB,KC_B),KC_LGUI,
+        KC_LSPO,LT(SYMB,KC_Z),   TD_X_QUOT,   KC_C,TD_V_MINS,LT(SYMB,KC_B),KC_LCAO,
         KC_LCFS,      KC_QUOT,   OSL(ALPH),KC_LEFT,KC_RGHT,
 	/*         Left Hand Island START ->       */ KC_TRNS,KC_TRNS,
                                                               KC_TRNS,
@@ -141,7 +120,7 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 	     KC_PLUS,     KC_6,   KC_7,  KC_8,   KC_9,   KC_0,             KC_GT,
 	     KC_MINS,     KC_Y,   KC_U,  KC_I,   KC_O,   KC_P,             KC_RCBC,
 	                  KC_H,   KC_J,  KC_K,   KC_L,   KC_SCLN,          KC_RCCC,
-             KC_RGUI,     KC_N,   KC_M,  KC_COMM,KC_DOT,LT(SYMB,KC_SLSH),  KC_RSPC,
+             KC_RCAC,     KC_N,   KC_M,  KC_COMM,KC_DOT,LT(SYMB,KC_SLSH),  KC_RSPC,
                                   KC_DOWN,KC_UP, KC_BSLS,KC_GRV,           KC_RCBS,
 	     KC_TRNS,     KC_TRNS, //  <- Right Hand Island START
              KC_TRNS,
@@ -153,173 +132,531 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 /* Keymap 1: Alpha Shift (reflect modifiers, transpose faces)
  *
  * ,--------------------------------------------------.           ,--------------------------------------------------.
- * |        |   1  |   2  |   3  |   4  |   5  |      |           |  +   |   6  |   7  |   8  |   9  |   0  |        |
+ * |   >    |   6  |   7  |   8  |   9  |   0  |  +   |           | LEAD |   1  |   2  |   3  |   4  |   5  |   <    |
  * |--------+------+------+------+------+-------------|           |------+------+------+------+------+------+--------|
- * | LAlt/[ |   Q  |   W  |   E  |   R  |   T  | Tab  |           |      |   Y  |   U  |   I  |   O  |   P  | RAlt/] |
+ * | RAlt/] |   Y  |   U  |   I  |   O  |   P  |S-Tab |           | Tab  |   Q  |   W  |   E  |   R  |   T  | LAlt/[ |
  * |--------+------+------+------+------+------|      |           |      |------+------+------+------+------+--------|
- * | LCtrl/{|   A  |   S  |   D  |   F  |   G  |------|           |------|   H  |   J  |   K  |   L  |   ;  | RCtrl/}|
- * |--------+------+------+------+------+------| LCmd |           | RCmd |------+------+------+------+------+--------|
- * |LShift/(|  Z   |   X  |   C  |   V  |   B  | /Win |           | /Win |   N  |   M  |   ,  |   .  |   /  |RShift/)|
+ * | RCtrl/}|   H  |   J  |   K  |   L  |   ;  |------|           |------|   A  |   S  |   D  |   F  |   G  | LCtrl/{|
+ * |--------+------+------+------+------+------| RCmd |           | LCmd |------+------+------+------+------+--------|
+ * |RShift/)|   N  |   M  |   ,  |   .  |   /  |      |           |      |   Z  |X 2x' |   C  |V 2x- |   B  |LShift/(|
  * `--------+------+------+------+------+-------------'           `-------------+------+------+------+------+--------'
- *   | LCmd |  '"  |O_MDIA| Left | Right|                                       | Down |  Up  |   \  |   `  | RCmd |
+ *   | RCmd |  '"  |O_MDIA| Down |  Up  |                                       | Left | Right|   -  |   '  | RCmd |
  *   `----------------------------------'                                       `----------------------------------'
  *                                        ,-------------.       ,---------------.
  *                                        |      |      |       |      |        |
  *                                 ,------|------|------|       |------+--------+------.
- *                                 |      | Back |      |       |      |        |      |
- *                                 | Space| Space|------|       |------|  Del   |Enter |
  *                                 |      |      |      |       |      |        |      |
+ *                                 |Enter |  Del |------|       |------| Back   |Space |
+ *                                 |      | /Mdia|      |       |      | Space  |      |
+ *                                 |      |      |      |       |      | /Nav   |      |
  *                                 `--------------------'       `----------------------'
  */
-// If it accepts an argument (i.e, is a function), it doesn't need KC_.
-// Otherwise, it needs KC_*
-[ALPH] = KEYMAP(  // layer 0 : default
-        // Left Hand   |             |       |       |       |       |             |
-        KC_TRNS,        KC_6,         KC_7,   KC_8,   KC_9,   KC_0,   KC_PLUS,
-        KC_RCBC,        KC_Y,         KC_U,   KC_I,   KC_O,   KC_P,   KC_TRNS, // this should become shift+tab
-	KC_RCCC,        KC_H,         KC_J,   KC_K,   KC_L,   KC_SCLN,
-	KC_RSPC,        KC_N,         KC_M,   KC_COMM,KC_DOT, KC_SLSH, KC_RGUI,
-        KC_RGUI,        KC_TRNS, OSL(MDIA),   KC_DOWN,KC_UP,
-	/*         Left Hand Island START ->       */ KC_TRNS,KC_TRNS,
-                                                              KC_TRNS,
-	                             KC_ENT,LT(MDIA, KC_DELT),KC_TRNS,
-        // Right Hand    |       |      |       |       |                 |
-	     KC_TRNS,     KC_1,   KC_2,  KC_3,   KC_4,   KC_5,             KC_TRNS,
-	     KC_TAB,      KC_Q,   KC_W,  KC_E,   KC_R,   KC_T,             KC_LCBO,
-                          KC_A,   KC_S,  KC_D,   KC_F,   KC_G,             KC_LCCO,
-             KC_LGUI,     KC_Z,   KC_X,  KC_C,   KC_V,   KC_B,             KC_LSPO,
-                                  KC_LEFT,KC_RIGHT,KC_MINS,KC_QUOT,        KC_RGUI,
-	     KC_TRNS,     KC_TRNS, //  <- Right Hand Island START
-             KC_TRNS,
-             KC_TRNS,LT(NAV, KC_BSPC),KC_SPC
-    ),
-/* Keymap 3: Symbol Layer
- * Wanted keys on left hand: # " ' ` ~
- *
- * ,---------------------------------------------------.           ,--------------------------------------------------.
- * |Version  |  F1  |  F2  |  F3  |  F4  |  F5  |      |           |      |  F6  |  F7  |  F8  |  F9  |  F10 |   F11  |
- * |---------+------+------+------+------+------+------|           |------+------+------+------+------+------+--------|
- * |         |      |  |   |  #   |  =   |  ~   |      |           |      |   Up |   7  |   8  |   9  |   *  |   F12  |
- * |---------+------+------+------+------+------|      |           |      |------+------+------+------+------+--------|
- * |         |      |  :   |  "   |  -   |  `   |------|           |------| Down |   4  |   5  |   6  |   +  |        |
- * |---------+------+------+------+------+------|      |           |      |------+------+------+------+------+--------|
- * |         |      |  ;   |  '   |  _   |      |      |           |      |   &  |   1  |   2  |   3  |   \  |        |
- * `---------+------+------+------+------+-------------'           `-------------+------+------+------+------+--------'
- *   | EPRM  |      |O_ALPH|  \   |  /   |                                       |      |    . |   0  |   =  |      |
- *   `-----------------------------------'                                       `----------------------------------'
- *                                        ,-------------.       ,-------------.
- *                                        |Animat|      |       |Toggle|Solid |
- *                                 ,------|------|------|       |------+------+------.
- *                                 |Bright|Bright|      |       |      |Hue-  |Hue+  |
- *                                 |ness- |ness+ |------|       |------|      |      |
- *                                 |      |      |      |       |      |      |      |
- *                                 `--------------------'       `--------------------'
- */
-// SYMBOLS
-[SYMB] = KEYMAP(
-       // left hand
-       VRSN,   KC_F1,      KC_F2,  KC_F3,  KC_F4,  KC_F5,  KC_TRNS,
-       KC_TRNS,KC_TRNS,  KC_PIPE,KC_HASH, KC_EQL,KC_TILD,KC_TRNS,
-       KC_TRNS,KC_TRNS,  KC_COLN, KC_DQT,KC_MINS, KC_GRV,
-       KC_TRNS,KC_TRNS,  KC_SCLN,KC_QUOT,KC_UNDS,KC_TRNS,KC_TRNS,
-          EPRM,KC_TRNS,OSL(ALPH),KC_BSLS,KC_SLSH,
-                                       RGB_MOD,KC_TRNS,
-                                               KC_TRNS,
-                               KC_TRNS,KC_TRNS,KC_TRNS,
-       // right hand
-       KC_TRNS, KC_F6,   KC_F7,  KC_F8,   KC_F9,   KC_F10,  KC_F11,
-       KC_TRNS, KC_UP,   KC_7,   KC_8,    KC_9,    KC_ASTR, KC_F12,
-                KC_DOWN, KC_4,   KC_5,    KC_6,    KC_PLUS, KC_TRNS,
-       KC_TRNS, KC_AMPR, KC_1,   KC_2,    KC_3,    KC_BSLS, KC_TRNS,
-                         KC_TRNS,KC_DOT,  KC_0,    KC_EQL,  KC_TRNS,
-       RGB_TOG, RGB_SLD,
-       KC_TRNS,
-       KC_TRNS, KC_TRNS, KC_TRNS
-),
-/* Keymap 2: Media keys (media, mouse, browser)
- *
- * ,--------------------------------------------------.           ,--------------------------------------------------.
- * |        |      |      |      | Mute |      |      |           |      |      |      |      |      |      |        |
- * |--------+------+------+------+------+-------------|           |------+------+------+------+------+------+--------|
- * |        |      |      |      |VolUp |      |      |           |      | Lclk | MsUp | Rclk |      |      |        |
- * |--------+------+------+------+------+------|      |           |      |------+------+------+------+------+--------|
- * |        |      |      | Prev | Play | Next |------|           |------|MsLeft|MsDown|MsRigt|      |      |        |
- * |--------+------+------+------+------+------|      |           |      |------+------+------+------+------+--------|
- * |        |      |      |      |VolDn |      |      |           |      |      |      |      |      |      |        |
- * `--------+------+------+------+------+-------------'           `-------------+------+------+------+------+--------'
- *   |      |      |      |      |      |                                       |      |      |      |      |      |
- *   `----------------------------------'                                       `----------------------------------'
- *                                        ,-------------.       ,-------------.
- *                                        |      |      |       |      |      |
- *                                 ,------|------|------|       |------+------+------.
- *                                 |      |      |      |       |      |      |Brwser|
- *                                 |      |      |------|       |------|      |Back  |
- *                                 |      |      |      |       |      |      |      |
- *                                 `--------------------'       `--------------------'
- */
-// Media{
-[MDIA] = KEYMAP(
-       KC_TRNS, KC_TRNS,  KC_TRNS,  KC_TRNS, KC_MUTE, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS,  KC_TRNS,  KC_TRNS, KC_VOLU, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS,  KC_TRNS,  KC_MPRV, KC_MPLY, KC_MNXT,
-       KC_TRNS, KC_TRNS,  KC_TRNS,  KC_TRNS, KC_VOLD, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS,OSL(SYMB), KC_TRNS, KC_TRNS,
-                                           KC_TRNS, KC_TRNS,
-                                                    KC_TRNS,
-                                  KC_TRNS, KC_TRNS, KC_TRNS,
-    // right hand
-       KC_TRNS,  KC_TRNS, KC_BTN3, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
-       KC_TRNS,  KC_BTN1, KC_MS_U, KC_BTN2, KC_TRNS, KC_TRNS, KC_TRNS,
-                 KC_MS_L, KC_MS_D, KC_MS_R, KC_TRNS, KC_TRNS, KC_TRNS,
-       KC_TRNS,  KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
-                          KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS,
-       KC_TRNS,
-       KC_TRNS, KC_TRNS, KC_WBAK
-),
-/* Keymap 4: nav layer
- *                                
- * ,--------------------------------------------------.           ,--------------------------------------------------.
- * |        |      |      |      | Mute |      |      |           |      |      |      |      |      |      |        |
- * |--------+------+------+------+------+-------------|           |------+------+------+------+------+------+--------|
- * |        |      |      |      |sxp-^ |      |      |           |      |      | MsUp | Lclk |      |      |        |
- * |--------+------+------+------+------+------|      |           |      |------+------+------+------+------+--------|
- * |        |      |      | <-sxp|sxp-dn|sxp-> |------|           |------|MsLeft|MsDown|MsRigt|      |      |        |
- * |--------+------+------+------+------+------|      |           |      |------+------+------+------+------+--------|
- * |        |      |      |      |      |      |      |           | Rclk |      |      |      |      |      |        |
- * `--------+------+------+------+------+-------------'           `-------------+------+------+------+------+--------'
- *   |      |      |      |      |      |                                       |      |      |      |      |      |
- *   `----------------------------------'                                       `----------------------------------'
- *                                        ,-------------.       ,-------------.
- *                                        |      |      |       |      |      |
- *                                 ,------|------|------|       |------+------+------.
- *                                 |      |      |      |       |      |      |Brwser|
- *                                 |      |      |------|       |------|      |Back  |
- *                                 |      |      |      |       |      |      |      |
- *                                 `--------------------'       `--------------------'
- */
-// Nav {
-[NAV] = KEYMAP(
-       KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_MUTE, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_VOLU, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS, KC_TRNS, KC_MPRV, KC_MPLY, KC_MNXT,
-       KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_VOLD, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
-                                           KC_TRNS, KC_TRNS,
-                                                    KC_TRNS,
-                                  KC_TRNS, KC_TRNS, KC_TRNS,
-    // right hand
-       KC_TRNS,  KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
-       KC_TRNS,  KC_BTN2, KC_MS_U, KC_BTN1, KC_TRNS, KC_TRNS, KC_TRNS,
-                 KC_MS_L, KC_MS_D, KC_MS_R, KC_TRNS, KC_TRNS, KC_TRNS,
-       KC_TRNS,  KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
-                          KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
-       KC_TRNS, KC_TRNS,
-       KC_TRNS,
-       KC_TRNS, KC_TRNS, KC_WBAK
-)
+// Not stored here: ALPH is derived from BASE, see ALPHA MIRROR below
+// SYMB, MDIA and NAV are in sparse_layers.def, see SPARSE LAYERS below
+};
+
+// KEYMAP OVERLAY
+// With RAW_ENABLE, single keys on any layer can be rebound from the host
+// without reflashing: sim/ambi-patch sends the commands in overlay.h, and
+// OVERLAY OVER RAW HID below carries them out. The overrides live in
+// overlay[], are saved at OVERLAY_EEPROM OVERLAY_SAVE_DELAY ms after the
+// last change, and layer_keycode() checks them before the compiled
+// keymaps. overlay_layers has a bit per layer with an override, so while
+// the overlay is empty, or for any layer it leaves alone, that check is
+// one bit test.
+#ifdef RAW_ENABLE
+#define OVERLAY_EEPROM ((uint8_t *)256) // past the settings at SETTINGS_EEPROM
+#define OVERLAY_EEPROM_MAGIC (0xB0 | OVERLAY_HID_VERSION)
+#define OVERLAY_SAVE_DELAY 1000
+
+_Static_assert(LAYER_COUNT <= 8, "overlay_layers has a bit per layer");
+
+static overlay_entry_t overlay[OVERLAY_CAPACITY];
+static uint8_t overlay_count;
+static uint8_t overlay_layers;
+static bool overlay_dirty;
+static uint16_t overlay_timer;
+
+static overlay_entry_t *overlay_find(uint8_t layer, uint8_t pos) {
+  for (uint8_t i = 0; i < overlay_count; i++) {
+    if (overlay[i].pos == pos && overlay[i].layer == layer) {
+      return &overlay[i];
+    }
+  }
+  return NULL;
+}
+
+// The override for the key on the layer into *keycode, if there is one
+static bool overlay_keycode(uint8_t layer, keypos_t key, uint16_t *keycode) {
+  overlay_entry_t *entry;
+
+  if (!(overlay_layers & (1 << layer)) ||
+      !(entry = overlay_find(layer, OVERLAY_POS(key.row, key.col)))) {
+    return false;
+  }
+  *keycode = entry->keycode[0] | entry->keycode[1] << 8;
+  return true;
+}
+
+#ifdef KEYMAP_CACHE
+// Bit per matrix col of a row that the layer has an override for
+static uint8_t overlay_cols(uint8_t layer, uint8_t row) {
+  uint8_t cols = 0;
+
+  if (overlay_layers & (1 << layer)) {
+    for (uint8_t i = 0; i < overlay_count; i++) {
+      if (overlay[i].layer == layer && overlay[i].pos >> 3 == row) {
+        cols |= 1 << (overlay[i].pos & 7);
+      }
+    }
+  }
+  return cols;
+}
+#endif
+
+static void overlay_index(void) {
+  overlay_layers = 0;
+  for (uint8_t i = 0; i < overlay_count; i++) {
+    overlay_layers |= 1 << overlay[i].layer;
+  }
+}
+
+// Entries that no longer fit the keymap are dropped
+static void overlay_init(void) {
+  uint8_t count = 0;
+
+  overlay_count = 0;
+  if (eeprom_read_byte(OVERLAY_EEPROM) == OVERLAY_EEPROM_MAGIC) {
+    count = eeprom_read_byte(OVERLAY_EEPROM + 1);
+    count = count > OVERLAY_CAPACITY ? OVERLAY_CAPACITY : count;
+    eeprom_read_block(overlay, OVERLAY_EEPROM + 2, count * sizeof(overlay_entry_t));
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    if (overlay[i].layer < LAYER_COUNT && overlay[i].pos >> 3 < MATRIX_ROWS &&
+        (overlay[i].pos & 7) < MATRIX_COLS) {
+      overlay[overlay_count++] = overlay[i];
+    }
+  }
+  overlay_index();
+  overlay_dirty = false;
+}
+
+// Called once per scan from matrix_scan_user
+static void overlay_task(void) {
+  if (!overlay_dirty || timer_elapsed(overlay_timer) < OVERLAY_SAVE_DELAY) {
+    return;
+  }
+  eeprom_update_byte(OVERLAY_EEPROM + 1, overlay_count);
+  eeprom_update_block(overlay, OVERLAY_EEPROM + 2, overlay_count * sizeof(overlay_entry_t));
+  eeprom_update_byte(OVERLAY_EEPROM, OVERLAY_EEPROM_MAGIC);
+  overlay_dirty = false;
+}
+#else
+#define overlay_task()
+#endif
+
+// ALPHA MIRROR
+// ALPH swaps the hands: on the four main rows, each position takes BASE's
+// keycode from the other hand. The modifier columns (outer and inner) are
+// reflected, so LAlt/[ swaps with RAlt/], and the face columns are
+// translated, so Q W E R T swaps with Y U I O P in the same order.
+// alph_overrides lists the positions where ALPH really differs from that.
+// This covers the number row ends, which stay BASE's, the Tab column,
+// the Z row without its layer taps, the bottom row and the thumbs.
+// Anything else on the bottom row or thumbs is transparent.
+#define ALPH_MIRROR_COLS 4 // matrix cols (physical rows) the mirror covers
+#define ALPH_POS(row, col) ((row) << 3 | (col))
+
+// Matrix row (physical column) on BASE that each ALPH row reads
+static const uint8_t PROGMEM alph_mirror[MATRIX_ROWS] = {
+  13, 8, 9, 10, 11, 12, 7,  // left hand: outer, faces, inner
+  6, 1, 2, 3, 4, 5, 0       // right hand: inner, faces, outer
+};
+
+typedef struct {
+  uint8_t pos; // ALPH_POS(row, col)
+  uint16_t keycode;
+} alph_override_t;
+
+// Sorted by pos
+static const alph_override_t PROGMEM alph_overrides[] = {
+  { ALPH_POS( 0, 0), KC_TRNS },
+  { ALPH_POS( 0, 4), KC_RGUI },
+  { ALPH_POS( 2, 4), OSL(MDIA) },
+  { ALPH_POS( 2, 5), LT(MDIA, KC_DELT) },
+  { ALPH_POS( 3, 4), KC_DOWN },
+  { ALPH_POS( 3, 5), KC_ENT },
+  { ALPH_POS( 4, 4), KC_UP },
+  { ALPH_POS( 5, 3), KC_SLSH },
+  { ALPH_POS( 6, 1), LSFT(KC_TAB) },
+  { ALPH_POS( 7, 0), KC_TRNS },
+  { ALPH_POS( 7, 1), KC_TAB },
+  { ALPH_POS( 8, 3), KC_Z },
+  { ALPH_POS( 9, 4), KC_LEFT },
+  { ALPH_POS(10, 4), KC_RIGHT },
+  { ALPH_POS(10, 5), KC_SPC },
+  { ALPH_POS(11, 4), KC_MINS },
+  { ALPH_POS(11, 5), LT(NAV, KC_BSPC) },
+  { ALPH_POS(12, 3), KC_B },
+  { ALPH_POS(12, 4), KC_QUOT },
+  { ALPH_POS(13, 0), KC_TRNS },
+  { ALPH_POS(13, 4), KC_RGUI }
+};
+
+#define ALPH_OVERRIDE_COUNT (sizeof(alph_overrides) / sizeof(alph_overrides[0]))
+
+static uint16_t alph_keycode(keypos_t key) {
+  uint8_t pos = ALPH_POS(key.row, key.col);
+
+  for (uint8_t i = 0; i < ALPH_OVERRIDE_COUNT; i++) {
+    uint8_t at = pgm_read_byte(&alph_overrides[i].pos);
+    if (at == pos) {
+      return pgm_read_word(&alph_overrides[i].keycode);
+    }
+    if (at > pos) {
+      break;
+    }
+  }
+  if (key.col >= ALPH_MIRROR_COLS) {
+    return KC_TRNS;
+  }
+  key.row = pgm_read_byte(&alph_mirror[key.row]);
+#ifdef RAW_ENABLE
+  uint16_t keycode;
+  if (overlay_keycode(BASE, key, &keycode)) {
+    return keycode;
+  }
+#endif
+  return pgm_read_word(&keymaps[BASE][key.row][key.col]);
+}
+
+// SPARSE LAYERS
+// Layers that are mostly KC_TRNS are declared in sparse_layers.def and
+// packed into sparse_layers.h (make -C sim sparse_layers). Each row keeps a
+// bit per matrix col that isn't transparent and where its keycodes start in
+// sparse_keys[], which holds only those keycodes in matrix order. A key's
+// keycode is then at the row's start plus the number of bits set below its
+// col, so a lookup costs two more PROGMEM reads than a dense one.
+typedef struct {
+  uint8_t cols;  // bit per matrix col whose keycode isn't KC_TRNS
+  uint8_t first; // index in sparse_keys[] of the row's first keycode
+} sparse_row_t;
+
+#define SPARSE_NONE 0xFF // sparse_slots[] entry for layers that aren't sparse
+
+#include "sparse_layers.h"
+
+enum sparse_layer_defs {
+#define SPARSE_LAYER(layer, ...) SPARSE_DEF_##layer,
+#include "sparse_layers.def"
+#undef SPARSE_LAYER
+  SPARSE_DEF_COUNT
+};
+
+_Static_assert(SPARSE_LAYER_COUNT == SPARSE_DEF_COUNT,
+               "sparse_layers.h is stale, run make -C sim sparse_layers");
+_Static_assert(SPARSE_LAYER_DEF_CKSUM == SPARSE_DEF_CKSUM,
+               "sparse_layers.def changed since sparse_layers.h was made, run make -C sim sparse_layers");
+_Static_assert(MATRIX_COLS <= 6, "sparse_popcount only covers the 5 cols below a key");
+
+// Bits set in each value below 1 << 5
+static const uint8_t PROGMEM sparse_popcount[32] = {
+  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5
 };
 
+static uint16_t sparse_keycode(uint8_t slot, keypos_t key) {
+  const sparse_row_t *row = &sparse_rows[slot][key.row];
+  uint8_t cols = pgm_read_byte(&row->cols);
+  uint8_t bit = 1 << key.col;
+
+  if (!(cols & bit)) {
+    return KC_TRNS;
+  }
+  return pgm_read_word(&sparse_keys[pgm_read_byte(&row->first) +
+                                    pgm_read_byte(&sparse_popcount[cols & (bit - 1)])]);
+}
+
+// Keycode on one layer, KC_TRNS where it falls through
+static uint16_t layer_keycode(uint8_t layer, keypos_t key) {
+  uint8_t slot;
+
+  // LT(ALL_T(KC_NO), ...) and friends can set bits past the last layer
+  if (layer >= LAYER_COUNT) {
+    return KC_TRNS;
+  }
+#ifdef RAW_ENABLE
+  uint16_t keycode;
+  if (overlay_keycode(layer, key, &keycode)) {
+    return keycode;
+  }
+#endif
+  if (layer == ALPH) {
+    return alph_keycode(key);
+  }
+  slot = pgm_read_byte(&sparse_slots[layer]);
+  if (slot != SPARSE_NONE) {
+    return sparse_keycode(slot, key);
+  }
+  if (layer >= sizeof(keymaps) / sizeof(keymaps[0])) {
+    return KC_TRNS;
+  }
+  return pgm_read_word(&keymaps[layer][key.row][key.col]);
+}
+
+// KEYMAP CACHE
+// QMK finds a key's keycode by asking keymap_key_to_keycode() for each
+// active layer from the top until one isn't KC_TRNS, and on the mostly
+// transparent layers that is usually all the way down to BASE. With
+// KEYMAP_CACHE, the layer each key resolves on under the current layer
+// state, and its keycode there, are kept in RAM. Layers above it answer
+// KC_TRNS and it answers the keycode, so each step of the walk is an array
+// read and the walk stops where it would without the cache. That has to be
+// the real layer: QMK looks the release up again on it.
+// KEYMAP_CACHE is how many layer states are kept, 257 bytes each. Going
+// back to one of them is free. Otherwise the least recently used one is
+// brought up to date in place, and only the positions that a layer turned
+// on or off has a keycode for are resolved again.
+#ifdef KEYMAP_CACHE
+#define KEYCACHE_LAYERS ((1UL << LAYER_COUNT) - 1)
+
+typedef struct {
+  uint32_t state; // active layers the keys were resolved under
+  uint8_t used;   // keycache_clock when last switched to
+  uint8_t layers[MATRIX_ROWS][MATRIX_COLS]; // layer each key resolved on
+  uint16_t keys[MATRIX_ROWS][MATRIX_COLS];  // its keycode there
+} keycache_t;
+
+// State 0 never matches, so the first lookup builds an entry from scratch
+static keycache_t keycache[KEYMAP_CACHE];
+static keycache_t *keycache_current = keycache;
+static uint8_t keycache_clock;
+
+// Bit per matrix col of a row that the layer has a keycode for
+static uint8_t layer_cols(uint8_t layer, uint8_t row) {
+  uint8_t slot, cols;
+
+  if (layer == ALPH) {
+    cols = (1 << ALPH_MIRROR_COLS) - 1;
+    for (uint8_t i = 0; i < ALPH_OVERRIDE_COUNT; i++) {
+      uint8_t pos = pgm_read_byte(&alph_overrides[i].pos);
+      if (pos >> 3 == row) {
+        cols |= 1 << (pos & 7);
+      }
+    }
+    return cols;
+  }
+  slot = pgm_read_byte(&sparse_slots[layer]);
+  if (slot != SPARSE_NONE) {
+    return pgm_read_byte(&sparse_rows[slot][row].cols);
+  }
+  if (layer >= sizeof(keymaps) / sizeof(keymaps[0])) {
+    return 0;
+  }
+  return (1 << MATRIX_COLS) - 1;
+}
+
+// The walk of layer_switch_get_layer() over entry's layers: the top one that
+// isn't KC_TRNS at key, or BASE if none is
+static void keycache_resolve(keycache_t *entry, keypos_t key) {
+  uint8_t layer = BASE;
+  uint16_t keycode = KC_TRNS;
+
+  for (int8_t i = biton32(entry->state & KEYCACHE_LAYERS); i >= 0; i--) {
+    if (entry->state & (1UL << i)) {
+      keycode = layer_keycode(i, key);
+      if (keycode != KC_TRNS) {
+        layer = i;
+        break;
+      }
+    }
+  }
+  entry->layers[key.row][key.col] = layer;
+  entry->keys[key.row][key.col] = keycode;
+}
+
+static void keycache_switch(uint32_t state) {
+  keycache_t *entry = keycache;
+  uint8_t dirty[MATRIX_ROWS] = { 0 };
+  uint32_t changed;
+  keypos_t key;
+
+  for (uint8_t i = 0; i < KEYMAP_CACHE; i++) {
+    if (keycache[i].state == state) {
+      entry = &keycache[i];
+      break;
+    }
+    if ((uint8_t)(keycache_clock - keycache[i].used) > (uint8_t)(keycache_clock - entry->used)) {
+      entry = &keycache[i];
+    }
+  }
+  entry->used = ++keycache_clock;
+  keycache_current = entry;
+  if (entry->state == state) {
+    return;
+  }
+
+  changed = (entry->state ^ state) & KEYCACHE_LAYERS;
+  for (uint8_t layer = 0; layer < LAYER_COUNT; layer++) {
+    if (changed & (1UL << layer)) {
+      for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        dirty[row] |= layer_cols(layer, row);
+#ifdef RAW_ENABLE
+        dirty[row] |= overlay_cols(layer, row);
+#endif
+      }
+    }
+  }
+  entry->state = state;
+  for (key.row = 0; key.row < MATRIX_ROWS; key.row++) {
+    for (key.col = 0; key.col < MATRIX_COLS; key.col++) {
+      if (dirty[key.row] & (1 << key.col)) {
+        keycache_resolve(entry, key);
+      }
+    }
+  }
+}
+
+#ifdef RAW_ENABLE
+// Every key resolved again, for when the keymap itself has changed
+static void keycache_flush(void) {
+  keypos_t key;
+
+  for (uint8_t i = 0; i < KEYMAP_CACHE; i++) {
+    for (key.row = 0; key.row < MATRIX_ROWS; key.row++) {
+      for (key.col = 0; key.col < MATRIX_COLS; key.col++) {
+        keycache_resolve(&keycache[i], key);
+      }
+    }
+  }
+}
+#endif
+#endif
+
+// Replaces keymap_common.c's weak lookup
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+#ifdef KEYMAP_CACHE
+  uint32_t state = layer_state | default_layer_state;
+  uint8_t resolved;
+
+  if (state != keycache_current->state) {
+    keycache_switch(state);
+  }
+  resolved = keycache_current->layers[key.row][key.col];
+  if (layer == resolved) {
+    return keycache_current->keys[key.row][key.col];
+  }
+  if (layer > resolved && layer < LAYER_COUNT && (state & (1UL << layer))) {
+    return KC_TRNS;
+  }
+  // Below where the walk stops, or a layer that is no longer on: a release
+  // looked up on the layer it was pressed on
+  return layer_keycode(layer, key);
+#else
+  return layer_keycode(layer, key);
+#endif
+}
+
+// OVERLAY OVER RAW HID
+// One command per packet, see overlay.h. Changes take effect at once and
+// reach EEPROM from overlay_task(). A key held while its binding changes
+// is let go as whatever it was pressed as.
+#ifdef RAW_ENABLE
+static void overlay_changed(void) {
+  overlay_index();
+  overlay_dirty = true;
+  overlay_timer = timer_read();
+#ifdef KEYMAP_CACHE
+  keycache_flush();
+#endif
+}
+
+static void overlay_clear(void) {
+  overlay_count = 0;
+  overlay_changed();
+}
+
+void raw_hid_receive(uint8_t *data, uint8_t length) {
+  uint8_t reply[OVERLAY_HID_SIZE] = { length ? data[0] : 0, OVERLAY_BAD_ARGS };
+  keypos_t key;
+  bool at_key;
+  overlay_entry_t *entry;
+  uint16_t keycode;
+
+  if (length < OVERLAY_HID_SIZE) {
+    raw_hid_send(reply, sizeof(reply)); // too short to hold the arguments
+    return;
+  }
+  reply[1] = OVERLAY_OK;
+  key.row = data[2];
+  key.col = data[3];
+  at_key = data[1] < LAYER_COUNT && key.row < MATRIX_ROWS && key.col < MATRIX_COLS;
+  entry = at_key ? overlay_find(data[1], OVERLAY_POS(key.row, key.col)) : NULL;
+  switch (data[0]) {
+    case OVERLAY_INFO:
+      reply[2] = 'a';
+      reply[3] = 'm';
+      reply[4] = 'b';
+      reply[5] = 'o';
+      reply[6] = OVERLAY_HID_VERSION;
+      reply[7] = OVERLAY_CAPACITY;
+      reply[8] = overlay_count;
+      reply[9] = LAYER_COUNT;
+      reply[10] = MATRIX_ROWS;
+      reply[11] = MATRIX_COLS;
+      break;
+    case OVERLAY_GET:
+      if (!at_key) {
+        reply[1] = OVERLAY_BAD_ARGS;
+        break;
+      }
+      keycode = layer_keycode(data[1], key);
+      reply[2] = keycode & 0xFF;
+      reply[3] = keycode >> 8;
+      reply[4] = entry != NULL;
+      break;
+    case OVERLAY_SET:
+      if (!at_key) {
+        reply[1] = OVERLAY_BAD_ARGS;
+        break;
+      }
+      if (!entry) {
+        if (overlay_count == OVERLAY_CAPACITY) {
+          reply[1] = OVERLAY_FULL;
+          break;
+        }
+        entry = &overlay[overlay_count++];
+        entry->layer = data[1];
+        entry->pos = OVERLAY_POS(key.row, key.col);
+      }
+      entry->keycode[0] = data[4];
+      entry->keycode[1] = data[5];
+      overlay_changed();
+      break;
+    case OVERLAY_DEL:
+      if (!entry) {
+        reply[1] = OVERLAY_BAD_ARGS;
+        break;
+      }
+      *entry = overlay[--overlay_count];
+      overlay_changed();
+      break;
+    case OVERLAY_LIST:
+      reply[2] = overlay_count;
+      for (uint8_t i = 0; i < OVERLAY_LIST_MAX && data[1] + i < overlay_count; i++) {
+        ((overlay_entry_t *)&reply[3])[i] = overlay[data[1] + i];
+      }
+      break;
+    case OVERLAY_CLEAR:
+      overlay_clear();
+      break;
+    default:
+      reply[1] = OVERLAY_UNKNOWN;
+  }
+  raw_hid_send(reply, sizeof(reply));
+}
+#endif
+
 const uint16_t PROGMEM fn_actions[] = {
   [1] = ACTION_LAYER_TAP_TOGGLE(SYMB),                // FN1 - Momentary Layer 1 (Symbols)
 };
@@ -328,6 +665,9 @@ const uint16_t PROGMEM fn_actions[] = {
 #define WMAX_MACRO MACRO(D(LGUI), D(LALT), T(F), U(LALT), U(LGUI), END)
 #define WLEFT_MACRO MACRO(D(LGUI), D(LALT), D(LCTL), T(LEFT), U(LCTL), U(LALT), U(LGUI), END)
 #define WRGHT_MACRO MACRO(D(LGUI), D(LALT), D(LCTL), T(RGHT), U(LCTL), U(LALT), U(LGUI), END)
+#define SHIFT_S_MACRO MACRO(D(LSFT), T(S), U(LSFT), END)
+#define META_X_MACRO MACRO(D(LALT), T(X), U(LALT), END)
+#define ASD_MACRO MACRO(D(LGUI), T(S), U(LGUI), END)
 
 const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt)
 {
@@ -349,209 +689,1976 @@ const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt)
     return MACRO_NONE;
 };
 
-// Used for curly-cadet-shift; like space-cadet except it inserts {}
-static uint16_t ccs_timer[2] = {0, 0};
-// Used for bracket-cadet-shift; inserts []
-static uint16_t bcs_timer[2] = {0, 0};
-// Used for angle-bracket-cadet-shift; inserts / `\`
-static uint16_t scs_timer[2] = {0, 0};
-// Used for angle-bracket-cadet-shift; inserts <>
-//static uint16_t acs_timer[2] = {0, 0};
+// DYNAMIC MACROS
+// Rec on SYMB starts recording what the keyboard sends and stops it again;
+// Play types the recording back through the player (MACRO PLAYBACK below)
+// one report per scan, as fast as the host takes them. Only the changes
+// between reports are kept, a byte per key or modifier going up or down:
+//
+//   1 C P d d d d d  key: P pressed, d the keycode minus the previous key's,
+//                    -15..15; -16 means the keycode follows in a byte
+//   0 C P R m m m m  mods: P pressed, m the bits of the left (R clear) or
+//                    right (R set) half of the mods byte
+//
+// C is set on every edit but a report's last. A typed letter is two bytes,
+// where keyrecord_t copies would take eight. The report is compared with
+// the last one recorded whenever keystroke_send() sends one, before every
+// event and once per scan, which between them see every report QMK sends
+// except the tap inside a space cadet's release; that one is recorded by
+// mirroring process_space_cadet(). A report that doesn't fit ends the
+// recording.
+#ifndef DYNAMIC_MACRO_SIZE
+#define DYNAMIC_MACRO_SIZE 192
+#endif
+#define DM_KEY 0x80
+#define DM_MORE 0x40   // C
+#define DM_PRESS 0x20  // P
+#define DM_RIGHT 0x10  // R
+#define DM_DELTA 0x1F
+#define DM_ESCAPE 0x10 // delta of -16
 
-bool process_record_user(uint16_t keycode, keyrecord_t *record) {
-  switch (keycode) {
-    // dynamically generate these.
-    case EPRM:
-      if (record->event.pressed) {
-        eeconfig_init();
-      }
-      return false;
-      break;
-    case VRSN:
-      if (record->event.pressed) {
-        SEND_STRING (QMK_KEYBOARD "/" QMK_KEYMAP " @ " QMK_VERSION);
-      }
-      return false;
-      break;
-    case RGB_SLD:
-      if (record->event.pressed) {
-        #ifdef RGBLIGHT_ENABLE
-          rgblight_mode(1);
-        #endif
-      }
-      return false;
-      break;
-    case KC_LCCO: {  // LCtrl {
-      // This space cadet shift implementation is stolen from
-      // https://github.com/qmk/qmk_firmware/blob/d1fb8d2296889ee1aaa08988c8951eb5f12d930b/quantum/quantum.c
-      // Requires 2x custom keycodes, two timer values ine one array, and two case statements her
-      if (record->event.pressed) {
-        ccs_timer[0] = timer_read ();
-        register_mods(MOD_BIT(KC_LCTL));
-      }
-      else {
-	unregister_mods(MOD_BIT(KC_LCTL));	  
-        if (timer_elapsed(ccs_timer[0]) < TAPPING_TERM) {	      
-	  register_mods(MOD_BIT(KC_LSFT));
-          register_code(LCCO_KEY);
-          unregister_code(LCCO_KEY);
-	  unregister_mods(MOD_BIT(KC_LSFT));
-        }       
-      }
-    return false;
-    }
-    case KC_RCCC: { // RCtrl }
-      if (record->event.pressed) {
-        ccs_timer[1] = timer_read ();
-        register_mods(MOD_BIT(KC_RCTL));
-      }
-      else {
-	unregister_mods(MOD_BIT(KC_RCTL));	  
-        if (timer_elapsed(ccs_timer[1]) < TAPPING_TERM) {	      
-	  register_mods(MOD_BIT(KC_RSFT));
-          register_code(RCCC_KEY);
-          unregister_code(RCCC_KEY);
-	  unregister_mods(MOD_BIT(KC_RSFT));
-        }
-      }
-    return false;
-    }
-    case KC_LCBO: {  // LAlt [
-      if (record->event.pressed) {
-        bcs_timer[0] = timer_read ();
-        register_mods(MOD_BIT(KC_LALT));
-      }
-      else {
-	unregister_mods(MOD_BIT(KC_LALT));	  
-        if (timer_elapsed(bcs_timer[0]) < TAPPING_TERM) {	      
-          register_code(LCBO_KEY);
-          unregister_code(LCBO_KEY);
-        }
-      }
-    return false;
-    }
-    case KC_RCBC: {  // RAlt ]
-      if (record->event.pressed) {
-        bcs_timer[1] = timer_read ();
-        register_mods(MOD_BIT(KC_RALT));
-      }
-      else {
-	unregister_mods(MOD_BIT(KC_RALT));	  
-        if (timer_elapsed(bcs_timer[1]) < TAPPING_TERM) {	      
-          register_code(RCBC_KEY);
-          unregister_code(RCBC_KEY);
-        }
-      }
-    return false;
-    }
-    case KC_LCFS: {  // LGui `/`
-      if (record->event.pressed) {
-        scs_timer[0] = timer_read ();
-        register_mods(MOD_BIT(KC_LGUI));
-      }
-      else {
-	unregister_mods(MOD_BIT(KC_LGUI));
-        if (timer_elapsed(scs_timer[0]) < TAPPING_TERM) {	 
-          register_code(LCFS_KEY);
-          unregister_code(LCFS_KEY);	  
-        }
-      }
-    return false;
-    }
-    case KC_RCBS: {  // RGui `\`
-      if (record->event.pressed) {
-        scs_timer[1] = timer_read ();
-        register_mods(MOD_BIT(KC_RGUI));
-      }
-      else {
-	unregister_mods(MOD_BIT(KC_RGUI));
-        if (timer_elapsed(scs_timer[1]) < TAPPING_TERM) {	
-          register_code(RCBS_KEY);
-          unregister_code(RCBS_KEY);	 
-        }
-      }
-    return false;
-    }
+static uint8_t dm_buffer[DYNAMIC_MACRO_SIZE];
+static uint16_t dm_len;
+static uint16_t dm_report; // where the report being recorded starts
+static uint16_t dm_last;   // its last edit so far
+static bool dm_recording;
+static uint8_t dm_code;    // keycode of the last key edit
+static uint8_t dm_mods;    // report as last recorded
+static uint8_t dm_keys[6];
+static bool dm_spc_interrupted[2]; // KC_LSPO, KC_RSPC
+static uint16_t dm_spc_timer[2];
+
+static void dm_put(uint8_t byte) {
+  if (dm_len < DYNAMIC_MACRO_SIZE) {
+    dm_buffer[dm_len] = byte;
   }
-  return true;
+  dm_len++;
 }
 
-// Runs just one time when the keyboard initializes.
-void matrix_init_user(void) {
-  ergodox_led_all_on();
-  for (int i = LED_BRIGHTNESS_HI; i > LED_BRIGHTNESS_LO; i--) {
-    ergodox_led_all_set (i);
-    wait_ms (5);
+static void dm_key_edit(uint8_t code, bool pressed) {
+  int16_t delta = code - dm_code;
+  uint8_t edit = DM_KEY | DM_MORE | (pressed ? DM_PRESS : 0);
+
+  dm_last = dm_len;
+  if (delta >= -15 && delta <= 15) {
+    dm_put(edit | (delta & DM_DELTA));
   }
-  wait_ms(1000);
-  for (int i = LED_BRIGHTNESS_LO; i > 0; i--) {
-    ergodox_led_all_set (i);
-    wait_ms (10);
+  else {
+    dm_put(edit | DM_ESCAPE);
+    dm_put(code);
   }
-  ergodox_led_all_off();
-};
+  dm_code = code;
+}
+
+static void dm_mods_edit(uint8_t mods, bool pressed) {
+  uint8_t edit = DM_MORE | (pressed ? DM_PRESS : 0);
+
+  if (mods & 0x0F) {
+    dm_last = dm_len;
+    dm_put(edit | (mods & 0x0F));
+  }
+  if (mods & 0xF0) {
+    dm_last = dm_len;
+    dm_put(edit | DM_RIGHT | mods >> 4);
+  }
+}
+
+static void dm_end_report(void) {
+  if (dm_len == dm_report) {
+    return;
+  }
+  if (dm_len > DYNAMIC_MACRO_SIZE) {
+    dm_len = dm_report;
+    dm_recording = false;
+    return;
+  }
+  dm_buffer[dm_last] &= ~DM_MORE;
+  dm_report = dm_len;
+}
+
+static bool dm_has_key(const uint8_t *keys, uint8_t code) {
+  for (uint8_t i = 0; i < 6; i++) {
+    if (keys[i] == code) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Records how the report differs from the last one recorded
+static void dm_capture(void) {
+  uint8_t mods = keyboard_report->mods;
+  uint8_t i;
+
+  if (!dm_recording) {
+    return;
+  }
+  dm_mods_edit(dm_mods & ~mods, false);
+  dm_mods_edit(mods & ~dm_mods, true);
+  for (i = 0; i < 6; i++) {
+    if (dm_keys[i] && !dm_has_key(keyboard_report->keys, dm_keys[i])) {
+      dm_key_edit(dm_keys[i], false);
+    }
+  }
+  for (i = 0; i < 6; i++) {
+    if (keyboard_report->keys[i] && !dm_has_key(dm_keys, keyboard_report->keys[i])) {
+      dm_key_edit(keyboard_report->keys[i], true);
+    }
+    dm_keys[i] = keyboard_report->keys[i];
+  }
+  dm_mods = mods;
+  dm_end_report();
+}
+
+static void dm_start(void) {
+  dm_len = dm_report = 0;
+  dm_code = 0;
+  dm_mods = keyboard_report->mods;
+  for (uint8_t i = 0; i < 6; i++) {
+    dm_keys[i] = keyboard_report->keys[i];
+  }
+  dm_recording = true;
+}
+
+static void dm_stop(void) {
+  dm_capture();
+  dm_recording = false;
+}
+
+// Called for every key event before it is handled
+static void dm_watch(uint16_t keycode, keyrecord_t *record) {
+  uint8_t side = keycode == KC_RSPC;
+  uint8_t code = side ? KC_0 : KC_9;
+
+  if (!dm_recording) {
+    return;
+  }
+  dm_capture();
+  if (keycode != KC_LSPO && keycode != KC_RSPC) {
+    return;
+  }
+  if (record->event.pressed) {
+    dm_spc_interrupted[side] = false;
+    dm_spc_timer[side] = timer_read();
+  }
+  else if (!dm_spc_interrupted[side] && timer_elapsed(dm_spc_timer[side]) < TAPPING_TERM) {
+    dm_key_edit(code, true);
+    dm_end_report();
+    if (dm_recording) { // the press may not have fit
+      dm_key_edit(code, false);
+      dm_end_report();
+    }
+  }
+}
+
+// Called for every key event the keymap passes on to QMK. Only those reach
+// process_space_cadet() and interrupt a space cadet there; keys the keymap
+// consumes, such as a pending combo or dance, don't.
+static void dm_passed(uint16_t keycode) {
+  if (dm_recording && keycode != KC_LSPO && keycode != KC_RSPC) {
+    dm_spc_interrupted[0] = dm_spc_interrupted[1] = true;
+  }
+}
+
+// KEYSTROKES
+// register_code() sends a report for every code, so a shifted key used to
+// cost a frame for the shift, one for the key and two more to let go.
+// These only edit the report; keystroke_send() puts the whole change on the
+// wire at once, so a modifier and the key it modifies arrive together.
+static void keystroke_down(uint8_t code) {
+  if (IS_MOD(code)) {
+    add_mods(MOD_BIT(code));
+  }
+  else if (IS_KEY(code)) {
+    add_key(code);
+  }
+  else {
+    register_code(code); // media and system keys have their own reports
+  }
+}
+
+static void keystroke_up(uint8_t code) {
+  if (IS_MOD(code)) {
+    del_mods(MOD_BIT(code));
+  }
+  else if (IS_KEY(code)) {
+    del_key(code);
+  }
+  else {
+    unregister_code(code);
+  }
+}
+
+static void keystroke_send(void) {
+  send_keyboard_report();
+  dm_capture();
+}
+
+// mods + code in one report, released in the next
+static void keystroke_tap(uint8_t mods, uint8_t code) {
+  add_mods(mods);
+  keystroke_down(code);
+  keystroke_send();
+  keystroke_up(code);
+  del_mods(mods);
+  keystroke_send();
+}
+
+// MACRO PLAYBACK
+// Macros and strings are queued and played one step per matrix scan, so
+// keys pressed meanwhile are still scanned and processed in order.
+// A step is one run of macro presses or releases, a W() wait, or one
+// string char or hex digit; each step sends at most one report.
+// Strings are typed one report per char: the report that presses a char
+// also lets go of the one before, and Shift stays down through a run of
+// shifted chars. Only a char repeating the last one's key costs a report
+// of its own to let go first.
+#define PLAY_QUEUE_SIZE 4
+#define PLAY_HELD_SIZE 8 // a recording can hold down six keys and mods
+
+enum play_types {
+  PLAY_MACRO,  // PROGMEM macro_t[], as built by MACRO()
+  PLAY_STRING, // PROGMEM string, as built by PSTR()
+  PLAY_RAM_STRING, // string in RAM, which must stay put until it has played
+  PLAY_RAM_HEX,    // len bytes of RAM typed as lowercase hex, same caveat
+  PLAY_RECORDING   // len bytes of dm_buffer, see DYNAMIC MACROS; same caveat
+};
+
+typedef struct {
+  const uint8_t *data;
+  uint16_t len; // PLAY_RAM_HEX and PLAY_RECORDING only
+  uint8_t type;
+} play_item_t;
+
+static play_item_t play_queue[PLAY_QUEUE_SIZE];
+static uint8_t play_head;
+static uint8_t play_count;
+static const uint8_t *play_pos; // next byte of play_queue[play_head], NULL before it starts
+static uint8_t play_held[PLAY_HELD_SIZE]; // codes pressed by the player and not yet released
+static uint8_t play_char_code; // key of the last string char, still down; 0 if none
+static bool play_char_shift;   // Shift still down for it
+static bool play_low_nibble; // PLAY_RAM_HEX: high digit of *play_pos done
+static uint16_t play_timer;
+static uint8_t play_wait; // ms to wait before the next step, from W()
+static uint8_t play_code; // PLAY_RECORDING: keycode of the last key edit
+
+static bool play_enqueue(const uint8_t *data, uint16_t len, uint8_t type) {
+  if (play_count == PLAY_QUEUE_SIZE) {
+    return false;
+  }
+  play_queue[(play_head + play_count) % PLAY_QUEUE_SIZE] = (play_item_t){ data, len, type };
+  play_count++;
+  return true;
+}
+
+// Whether that many more items fit in the queue. An action made of several
+// items checks first, so it is dropped whole rather than played in part.
+static bool play_room(uint8_t items) {
+  return PLAY_QUEUE_SIZE - play_count >= items;
+}
+
+static bool play_macro(const macro_t *macro) {
+  return play_enqueue(macro, 0, PLAY_MACRO);
+}
+
+static bool play_string(const char *str) {
+  return play_enqueue((const uint8_t *)str, 0, PLAY_STRING);
+}
+
+static bool play_ram_string(const char *str) {
+  return play_enqueue((const uint8_t *)str, 0, PLAY_RAM_STRING);
+}
+
+#ifdef TRACE_ENABLE
+static bool play_ram_hex(const void *data, uint16_t len) {
+  return play_enqueue(data, len, PLAY_RAM_HEX);
+}
+#endif
+
+static bool play_recording(const uint8_t *data, uint16_t len) {
+  return len && play_enqueue(data, len, PLAY_RECORDING);
+}
+
+// play_press and play_release only edit the report; the step sends it
+static void play_press(uint8_t code) {
+  for (uint8_t i = 0; i < PLAY_HELD_SIZE; i++) {
+    if (!play_held[i]) {
+      play_held[i] = code;
+      break;
+    }
+  }
+  keystroke_down(code);
+}
+
+static void play_release(uint8_t code) {
+  for (uint8_t i = 0; i < PLAY_HELD_SIZE; i++) {
+    if (play_held[i] == code) {
+      play_held[i] = 0;
+    }
+  }
+  keystroke_up(code);
+}
+
+// Lets go of whatever the player still holds
+static void play_release_held(void) {
+  bool held = false;
+
+  for (uint8_t i = 0; i < PLAY_HELD_SIZE; i++) {
+    if (play_held[i]) {
+      play_release(play_held[i]);
+      held = true;
+    }
+  }
+  if (held) {
+    keystroke_send();
+  }
+}
+
+// Drops everything queued and lets go of whatever the player still holds
+static void play_cancel(void) {
+  play_release_held();
+  play_count = 0;
+  play_pos = NULL;
+  play_char_code = 0;
+  play_char_shift = false;
+  play_low_nibble = false;
+  play_wait = 0;
+}
+
+static void play_next_item(void) {
+  play_head = (play_head + 1) % PLAY_QUEUE_SIZE;
+  play_count--;
+  play_pos = NULL;
+}
+
+static void play_macro_step(void) {
+  uint8_t command = pgm_read_byte(play_pos++);
+
+  switch (command) {
+    case KEY_DOWN:
+    case KEY_UP:
+      // D(LSFT), T(S), U(LSFT) is two downs then two ups: one report each
+      for (;;) {
+        uint8_t code = pgm_read_byte(play_pos++);
+        if (command == KEY_DOWN) {
+          play_press(code);
+        }
+        else {
+          play_release(code);
+        }
+        if (pgm_read_byte(play_pos) != command) {
+          break;
+        }
+        play_pos++;
+      }
+      keystroke_send();
+      break;
+    case WAIT:
+      play_wait = pgm_read_byte(play_pos++);
+      play_timer = timer_read();
+      break;
+    case INTERVAL:
+      play_pos++; // every step is already one scan apart
+      break;
+    default: // END or anything the player doesn't know
+      play_next_item();
+      break;
+  }
+}
+
+// Presses ascii, letting go of the char before in the same report, and
+// returns true. Returns false without taking ascii when the char before is
+// on the same key and has to be let go first.
+static bool play_char_step(uint8_t ascii) {
+  uint8_t keycode = pgm_read_byte(&ascii_to_keycode_lut[ascii & 0x7F]);
+  bool shifted = pgm_read_byte(&ascii_to_shift_lut[ascii & 0x7F]);
+
+  if (!keycode) {
+    return true; // nothing types it
+  }
+  if (keycode == play_char_code) {
+    play_release(keycode);
+    play_char_code = 0;
+    keystroke_send();
+    return false;
+  }
+  if (play_char_code) {
+    play_release(play_char_code);
+  }
+  if (shifted != play_char_shift) {
+    if (shifted) {
+      play_press(KC_LSFT);
+    }
+    else {
+      play_release(KC_LSFT);
+    }
+    play_char_shift = shifted;
+  }
+  play_press(keycode);
+  play_char_code = keycode;
+  keystroke_send();
+  return true;
+}
+
+// Lets go of the last char at the end of a string; true if that took a report
+static bool play_char_end(void) {
+  if (!play_char_code && !play_char_shift) {
+    return false;
+  }
+  if (play_char_code) {
+    play_release(play_char_code);
+  }
+  if (play_char_shift) {
+    play_release(KC_LSFT);
+  }
+  play_char_code = 0;
+  play_char_shift = false;
+  keystroke_send();
+  return true;
+}
+
+static void play_string_step(void) {
+  uint8_t ascii = play_queue[play_head].type == PLAY_STRING ? pgm_read_byte(play_pos) : *play_pos;
+
+  if (!ascii) {
+    if (!play_char_end()) {
+      play_next_item();
+    }
+    return;
+  }
+  if (play_char_step(ascii)) {
+    play_pos++;
+  }
+}
+
+static void play_hex_step(void) {
+  const play_item_t *item = &play_queue[play_head];
+  uint8_t nibble;
+
+  if (play_pos == item->data + item->len) {
+    if (!play_char_end()) {
+      play_next_item();
+    }
+    return;
+  }
+  nibble = play_low_nibble ? *play_pos & 0xF : *play_pos >> 4;
+  if (play_char_step(nibble < 10 ? '0' + nibble : 'a' + nibble - 10)) {
+    play_pos += play_low_nibble;
+    play_low_nibble = !play_low_nibble;
+  }
+}
+
+// One recorded report; whatever the recording leaves held is let go at its end
+static void play_recording_step(void) {
+  const play_item_t *item = &play_queue[play_head];
+  uint8_t edit;
+
+  if (play_pos == item->data) {
+    play_code = 0;
+  }
+  if (play_pos == item->data + item->len) {
+    play_release_held();
+    play_next_item();
+    return;
+  }
+  do {
+    edit = *play_pos++;
+    if (edit & DM_KEY) {
+      uint8_t delta = edit & DM_DELTA;
+      play_code = delta == DM_ESCAPE ? *play_pos++ : play_code + ((int8_t)(delta << 3) >> 3);
+      if (edit & DM_PRESS) {
+        play_press(play_code);
+      }
+      else {
+        play_release(play_code);
+      }
+    }
+    else {
+      uint8_t code = edit & DM_RIGHT ? KC_RCTL : KC_LCTL;
+      for (uint8_t bit = 1; bit & 0x0F; bit <<= 1, code++) {
+        if (!(edit & bit)) {
+          continue;
+        }
+        if (edit & DM_PRESS) {
+          play_press(code);
+        }
+        else {
+          play_release(code);
+        }
+      }
+    }
+  } while (edit & DM_MORE);
+  keystroke_send();
+}
+
+// Called once per scan from matrix_scan_user
+static void play_task(void) {
+  if (!play_count) {
+    return;
+  }
+  if (play_wait) {
+    if (timer_elapsed(play_timer) < play_wait) {
+      return;
+    }
+    play_wait = 0;
+  }
+  if (!play_pos) {
+    play_pos = play_queue[play_head].data;
+  }
+  switch (play_queue[play_head].type) {
+    case PLAY_MACRO:
+      play_macro_step();
+      break;
+    case PLAY_RAM_HEX:
+      play_hex_step();
+      break;
+    case PLAY_RECORDING:
+      play_recording_step();
+      break;
+    default:
+      play_string_step();
+      break;
+  }
+}
+
+// SNIPPETS
+// Text typed by the leader is declared in snippets.def. Each snippet is a
+// PROGMEM string named by its id, so leader_action() plays it with
+// play_string().
+#define SNIPPET(id, text) static const char PROGMEM id[] = text;
+#include "snippets.def"
+#undef SNIPPET
+
+// SETTINGS
+// Timing parameters that can be tuned from the keyboard instead of
+// reflashing. They live in settings[] and are read from there on every use;
+// the Makefile values are only the defaults. The Tune key on SYMB selects
+// the next setting and Tune+/Tune- step it, each typing "<name> <value> "
+// so the result shows up in whatever has focus. Changes are written back to
+// EEPROM SETTINGS_SAVE_DELAY ms after the last one, so stepping through a
+// range costs one write per cell rather than one per press.
+#ifndef DANCE_TERM
+#define DANCE_TERM 150
+#endif
+#ifndef COMBO_TERM
+#define COMBO_TERM 40
+#endif
+#ifndef REPEAT_DELAY
+#define REPEAT_DELAY 250
+#endif
+#define CADET_TERM_MIN 40
+#define CADET_TERM_MAX 200 // QMK's default TAPPING_TERM; bounds learned terms too
+#define SETTINGS_SAVE_DELAY 5000
+#define SETTINGS_EEPROM ((uint8_t *)160) // past the cadet statistics at CADET_EEPROM
+
+// X(id, name, default, min, max, step). process_leader only swallows keys
+// for the compiled LEADER_TIMEOUT, so the leader timeout can only shrink.
+// A one-shot timeout of 0 waits for the next key however long it takes.
+// Each cadet has its own term, in cadets[] order. It is the term until the
+// cadet has learned one, and then moves the learned term by as much as it
+// is moved from TAPPING_TERM.
+// Layer taps keep QMK's compiled TAPPING_TERM. Repeat rates are taps/s.
+#ifdef KEY_REPEAT_ENABLE
+#define REPEAT_SETTINGS(X) \
+  X(SET_REPEAT_DELAY,    "repeat delay",     REPEAT_DELAY,   100,            1000,           25)  \
+  X(SET_REPEAT_RATE,     "repeat rate",      20,             5,              100,            5)   \
+  X(SET_REPEAT_MAX,      "repeat max",       60,             5,              100,            5)   \
+  X(SET_REPEAT_RAMP,     "repeat ramp",      1000,           0,              5000,           250)
+#else
+#define REPEAT_SETTINGS(X)
+#endif
+
+#define SETTINGS(X) \
+  X(SET_CADET_TERM_LCCO, "cadet { term",     TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_CADET_TERM_RCCC, "cadet } term",     TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_CADET_TERM_LCBO, "cadet [ term",     TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_CADET_TERM_RCBC, "cadet ] term",     TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_CADET_TERM_LCFS, "cadet / term",     TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_CADET_TERM_RCBS, "cadet \\ term",    TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_CADET_TERM_LCAO, "cadet < term",     TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_CADET_TERM_RCAC, "cadet > term",     TAPPING_TERM,   CADET_TERM_MIN, CADET_TERM_MAX, 5)   \
+  X(SET_DANCE_TERM,      "dance term",       DANCE_TERM,     50,             300,            10)  \
+  X(SET_COMBO_TERM,      "combo term",       COMBO_TERM,     10,             100,            5)   \
+  X(SET_LEADER_TIMEOUT,  "leader timeout",   LEADER_TIMEOUT, 200,            LEADER_TIMEOUT, 50)  \
+  X(SET_ONESHOT_TIMEOUT, "one-shot timeout", 0,              0,              5000,           250) \
+  REPEAT_SETTINGS(X)
+
+enum setting_ids {
+#define SETTING_ID(id, ...) id,
+  SETTINGS(SETTING_ID)
+#undef SETTING_ID
+  SETTING_COUNT
+};
+
+#define SETTINGS_EEPROM_MAGIC (0xA0 | SETTING_COUNT)
+
+_Static_assert(SET_CADET_TERM_RCAC - SET_CADET_TERM_LCCO == CADET_COUNT - 1,
+               "one cadet term per cadet, in cadets[] order");
+_Static_assert(1 + 2 * SETTING_COUNT <= 256 - 160, "settings must end before OVERLAY_EEPROM");
+
+typedef struct {
+  uint16_t def;
+  uint16_t min;
+  uint16_t max;
+  uint16_t step;
+} setting_info_t;
+
+static const setting_info_t PROGMEM settings_info[SETTING_COUNT] = {
+#define SETTING_INFO(id, name, def, min, max, step) [id] = { def, min, max, step },
+  SETTINGS(SETTING_INFO)
+#undef SETTING_INFO
+};
+
+#define setting_info(id, field) pgm_read_word(&settings_info[id].field)
+
+static uint16_t settings[SETTING_COUNT];
+static uint8_t setting_selected = SETTING_COUNT - 1; // the first Tune wraps to 0
+static bool settings_dirty;
+static uint16_t settings_timer;
+static char settings_line[sizeof(" 65535 ")];
+
+static const char *setting_name(uint8_t id) {
+  switch (id) {
+#define SETTING_NAME(id, name, ...) case id: return PSTR(name);
+    SETTINGS(SETTING_NAME)
+#undef SETTING_NAME
+  }
+  return PSTR("");
+}
+
+// Values out of range (a blank EEPROM, or a range that has since been
+// narrowed) fall back to the default one by one
+static void settings_init(void) {
+  uint16_t saved[SETTING_COUNT];
+  bool valid = eeprom_read_byte(SETTINGS_EEPROM) == SETTINGS_EEPROM_MAGIC;
+
+  if (valid) {
+    eeprom_read_block(saved, SETTINGS_EEPROM + 1, sizeof(saved));
+  }
+  for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+    settings[i] = setting_info(i, def);
+    if (valid && saved[i] >= setting_info(i, min) && saved[i] <= setting_info(i, max)) {
+      settings[i] = saved[i];
+    }
+  }
+  settings_dirty = false;
+}
+
+// Back to the Makefile defaults, which a blank magic byte also selects
+static void settings_reset(void) {
+  eeprom_update_byte(SETTINGS_EEPROM, 0xFF);
+  settings_init();
+  setting_selected = SETTING_COUNT - 1;
+}
+
+// Called once per scan from matrix_scan_user
+static void settings_task(void) {
+  if (!settings_dirty || timer_elapsed(settings_timer) < SETTINGS_SAVE_DELAY) {
+    return;
+  }
+  eeprom_update_block(settings, SETTINGS_EEPROM + 1, sizeof(settings));
+  eeprom_update_byte(SETTINGS_EEPROM, SETTINGS_EEPROM_MAGIC);
+  settings_dirty = false;
+}
+
+// " <value> " into settings_line
+static void settings_format(uint16_t value) {
+  char digits[5];
+  char *out = settings_line;
+  uint8_t count = 0;
+
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  *out++ = ' ';
+  while (count) {
+    *out++ = digits[--count];
+  }
+  *out++ = ' ';
+  *out = '\0';
+}
+
+// Tune (step 0) selects the next setting, Tune+ and Tune- step the
+// selected one within its range. Ignored while the player is busy, since
+// settings_line may still be playing.
+static void settings_tune(int8_t step) {
+  uint8_t id;
+  uint16_t value, by, min, max;
+
+  if (play_count) {
+    return;
+  }
+  if (!step) {
+    setting_selected = (setting_selected + 1) % SETTING_COUNT;
+  }
+  id = setting_selected;
+  value = settings[id];
+  by = setting_info(id, step);
+  min = setting_info(id, min);
+  max = setting_info(id, max);
+  if (step > 0) {
+    value = value > max - by ? max : value + by;
+  }
+  else if (step < 0) {
+    value = value < min + by ? min : value - by;
+  }
+  if (value != settings[id]) {
+    settings[id] = value;
+    settings_dirty = true;
+    settings_timer = timer_read();
+  }
+  if (play_room(2)) {
+    play_string(setting_name(id));
+    settings_format(value);
+    play_ram_string(settings_line);
+  }
+}
+
+// One-shot layers have no timeout of their own here; once the OSL key is
+// up, the layer is dropped after SET_ONESHOT_TIMEOUT ms without another key
+static uint16_t oneshot_timer;
+static bool oneshot_waiting;
+
+// Called once per scan from matrix_scan_user
+static void oneshot_timeout_task(void) {
+  uint8_t state = get_oneshot_layer_state();
+
+  if (!state || (state & ONESHOT_PRESSED) || !settings[SET_ONESHOT_TIMEOUT]) {
+    oneshot_waiting = false;
+    return;
+  }
+  if (!oneshot_waiting) {
+    oneshot_waiting = true;
+    oneshot_timer = timer_read();
+  }
+  else if (timer_elapsed(oneshot_timer) >= settings[SET_ONESHOT_TIMEOUT]) {
+    clear_oneshot_layer_state(ONESHOT_OTHER_KEY_PRESSED);
+    oneshot_waiting = false;
+  }
+}
+
+// Keys this keymap handles itself don't get as far as QMK's one-shot layer
+// release, so their presses let go of a waiting one-shot layer here
+static void oneshot_used(void) {
+  if (get_oneshot_layer_state() && !(get_oneshot_layer_state() & ONESHOT_PRESSED)) {
+    clear_oneshot_layer_state(ONESHOT_OTHER_KEY_PRESSED);
+  }
+}
+
+// LEADER DICTIONARY
+// Sequences are declared in leader.def and compiled into a PROGMEM trie in
+// leader_trie.h (make -C sim leader_trie). The trie is walked one key at a
+// time as the leader records them, so a lookup costs the sequence depth
+// rather than the size of the dictionary.
+enum leader_actions {
+#define LEADER_SEQ(action, ...) action,
+#include "leader.def"
+#undef LEADER_SEQ
+  LEADER_ACTION_COUNT,
+  LEADER_NONE = 0xFF
+};
+
+typedef struct {
+  uint8_t first_edge; // index of this node's first edge in leader_edges[]
+  uint8_t edge_count;
+  uint8_t action;     // leader_actions, LEADER_NONE if no sequence ends here
+} leader_node_t;
+
+typedef struct {
+  uint16_t keycode;
+  uint8_t node;       // index into leader_nodes[]
+} leader_edge_t;
+
+#include "leader_trie.h"
+
+_Static_assert(LEADER_TRIE_SEQ_COUNT == LEADER_ACTION_COUNT,
+               "leader_trie.h is stale, run make -C sim leader_trie");
+_Static_assert(LEADER_TRIE_DEF_CKSUM == LEADER_DEF_CKSUM,
+               "leader.def changed since leader_trie.h was made, run make -C sim leader_trie");
+
+// Stolen from https://docs.qmk.fm/leader_key.html; the timeout is
+// settings[SET_LEADER_TIMEOUT] rather than LEADER_TIMEOUT
+LEADER_EXTERNS();
+
+#define LEADER_DEAD 0xFF // no sequence starts with what has been typed
+
+// Current trie node for the sequence being typed; 0 is the root
+static uint8_t leader_node = LEADER_DEAD;
+
+static void leader_walk(uint16_t keycode) {
+  uint8_t first, count, i;
+
+  if (leader_node == LEADER_DEAD) {
+    return;
+  }
+  first = pgm_read_byte(&leader_nodes[leader_node].first_edge);
+  count = pgm_read_byte(&leader_nodes[leader_node].edge_count);
+  for (i = first; i < first + count; i++) {
+    if (pgm_read_word(&leader_edges[i].keycode) == keycode) {
+      leader_node = pgm_read_byte(&leader_edges[i].node);
+      return;
+    }
+  }
+  leader_node = LEADER_DEAD;
+}
+
+static void leader_action(uint8_t action) {
+  switch (action) {
+    case LA_SHIFT_S:
+      play_macro(SHIFT_S_MACRO);
+      break;
+    case LA_WMAX:
+      // Reference: https://docs.qmk.fm/macros.html
+      play_macro(WMAX_MACRO);
+      break;
+    case LA_WLEFT:
+      play_macro(WLEFT_MACRO);
+      break;
+    case LA_WRGHT:
+      play_macro(WRGHT_MACRO);
+      break;
+    case LA_CIDER:
+      if (play_room(2)) {
+        play_macro(META_X_MACRO);
+        play_string(SN_CIDER_CONNECT);
+      }
+      break;
+    case LA_CIDER_JACK_IN:
+      if (play_room(2)) {
+        play_macro(META_X_MACRO);
+        play_string(SN_CIDER_JACK_IN);
+      }
+      break;
+    case LA_NS:
+      play_string(SN_NS);
+      break;
+    case LA_COMMENT:
+      play_string(SN_COMMENT);
+      break;
+    case LA_REPL_REQUIRE:
+      play_string(SN_REPL_REQUIRE);
+      break;
+    case LA_REPL_PST:
+      play_string(SN_REPL_PST);
+      break;
+    case LA_REPL_PPRINT:
+      play_string(SN_REPL_PPRINT);
+      break;
+    case LA_REPL_DOC:
+      play_string(SN_REPL_DOC);
+      break;
+    case LA_AS:
+      play_macro(MACRO(T(H), END));
+      break;
+    case LA_ASD:
+      play_macro(ASD_MACRO);
+      break;
+  }
+}
+
+static void leader_finish(void) {
+  leading = false;
+  leader_end();
+  if (leader_node != LEADER_DEAD) {
+    leader_action(pgm_read_byte(&leader_nodes[leader_node].action));
+  }
+}
+
+// Mirrors process_leader(), which sees exactly the presses that
+// process_record_user lets through. Once no longer sequence can match
+// (a prefix-free sequence is complete, or nothing matches at all) the
+// leader finishes on this key instead of waiting out its timeout; the
+// timeout only decides ambiguous cases like W vs W LEFT.
+// Returns true when the key was consumed that way.
+static bool leader_track(uint16_t keycode) {
+  if (!leading) {
+    if (keycode == KC_LEAD) {
+      leader_node = 0;
+      play_cancel();
+    }
+    return false;
+  }
+  if (timer_elapsed(leader_time) >= settings[SET_LEADER_TIMEOUT]) {
+    return false;
+  }
+  leader_walk(keycode);
+  if (leader_node != LEADER_DEAD && pgm_read_byte(&leader_nodes[leader_node].edge_count)) {
+    return false;
+  }
+  leader_finish();
+  return true;
+}
+
+// Generic cadet shift: hold for a modifier, tap for a key (optionally wrapped in tap_mods).
+// This space cadet shift implementation is derived from
+// https://github.com/qmk/qmk_firmware/blob/d1fb8d2296889ee1aaa08988c8951eb5f12d930b/quantum/quantum.c
+typedef struct {
+  uint8_t hold_mods; // mods held while the key is down
+  uint8_t tap_key;   // basic keycode sent when released within term
+  uint8_t tap_mods;  // mods wrapped around tap_key, 0 for none
+} cadet_t;
+
+#define CADET(hold, key, mods) { MOD_BIT(hold), (key), (mods) }
+
+// Adding a cadet costs one keycode above and one row here
+static const cadet_t PROGMEM cadets[CADET_COUNT] = {
+  [KC_LCCO - CADET_FIRST] = CADET(KC_LCTL, LCCO_KEY, MOD_BIT(KC_LSFT)), // LCtrl {
+  [KC_RCCC - CADET_FIRST] = CADET(KC_RCTL, RCCC_KEY, MOD_BIT(KC_RSFT)), // RCtrl }
+  [KC_LCBO - CADET_FIRST] = CADET(KC_LALT, LCBO_KEY, 0),                // LAlt [
+  [KC_RCBC - CADET_FIRST] = CADET(KC_RALT, RCBC_KEY, 0),                // RAlt ]
+  [KC_LCFS - CADET_FIRST] = CADET(KC_LGUI, LCFS_KEY, 0),                // LGui `/`
+  [KC_RCBS - CADET_FIRST] = CADET(KC_RGUI, RCBS_KEY, 0),                // RGui `\`
+  [KC_LCAO - CADET_FIRST] = CADET(KC_LGUI, LCAO_KEY, MOD_BIT(KC_LSFT)), // LGui <
+  [KC_RCAC - CADET_FIRST] = CADET(KC_RGUI, RCAC_KEY, MOD_BIT(KC_RSFT))  // RGui >
+};
+
+// Press time of each cadet, indexed like cadets[]
+static uint16_t cadet_timer[CADET_COUNT];
+// Bit per cadet: down; another key was pressed while it was down; and
+// another key was pressed and released while it was down
+static uint8_t cadet_down;
+static uint8_t cadet_overlapped;
+static uint8_t cadet_interrupted;
+
+// With CADET_PERMISSIVE_HOLD, a cadet that another key was pressed and
+// released inside is a modifier however briefly it was held, so rolling
+// LCtrl/{ over X sends C-x without a stray {.
+#ifdef CADET_PERMISSIVE_HOLD
+#define cadet_permissive_hold(bit) (cadet_interrupted & (bit))
+#else
+#define cadet_permissive_hold(bit) 0
+#endif
+
+// CADET TERM LEARNING
+// Each cadet keeps a running mean and mean deviation (as in TCP's RTT
+// estimator) of how long it is held when tapped alone and when used as a
+// modifier for another key. Rolling over into the next key says nothing
+// either way and is not sampled. Its term is the upper edge of the tap group,
+// or halfway between the groups while they still overlap. The statistics
+// are saved to EEPROM so the learned terms survive a power cycle, but only
+// after a term has moved and at most every CADET_SAVE_DELAY ms, which keeps
+// a day of typing to a few dozen writes per cell.
+#define CADET_LEARN_MIN 8  // taps before the learned term replaces the default
+#define CADET_SAVE_DELAY 600000UL // ten minutes
+#define CADET_EEPROM_MAGIC (0xC0 | CADET_COUNT)
+#define CADET_EEPROM ((uint8_t *)32) // past QMK's eeconfig bytes
+
+typedef struct {
+  uint16_t avg; // ms << 4
+  uint16_t dev; // ms << 4, mean absolute deviation
+  uint8_t count; // saturates at 255
+} cadet_dist_t;
+
+typedef struct {
+  cadet_dist_t taps;
+  cadet_dist_t holds;
+} cadet_learn_t;
+
+static cadet_learn_t cadet_learn[CADET_COUNT];
+static uint8_t cadet_term[CADET_COUNT]; // 0 until learned, see cadet_term_get()
+static bool cadet_learn_dirty;
+static uint32_t cadet_save_timer;
+
+static void cadet_dist_add(cadet_dist_t *dist, uint8_t ms) {
+  int16_t error = ((uint16_t)ms << 4) - dist->avg;
+
+  if (!dist->count) {
+    dist->avg = (uint16_t)ms << 4;
+    dist->dev = (uint16_t)ms << 2; // assume a quarter until there is data
+  }
+  else {
+    dist->avg += error / 8;
+    dist->dev += ((error < 0 ? -error : error) - (int16_t)dist->dev) / 4;
+  }
+  if (dist->count < 255) {
+    dist->count++;
+  }
+}
+
+static void cadet_term_update(uint8_t index) {
+  const cadet_learn_t *learn = &cadet_learn[index];
+  uint16_t tap_edge = learn->taps.avg + 3 * learn->taps.dev;
+  uint16_t term;
+
+  if (learn->taps.count < CADET_LEARN_MIN) {
+    cadet_term[index] = 0;
+    return;
+  }
+  term = tap_edge;
+  if (learn->holds.count && learn->holds.avg < tap_edge + 2 * learn->holds.dev) {
+    term = (learn->taps.avg + learn->holds.avg) / 2;
+  }
+  term >>= 4;
+  if (term < CADET_TERM_MIN) {
+    term = CADET_TERM_MIN;
+  }
+  if (term > CADET_TERM_MAX) {
+    term = CADET_TERM_MAX;
+  }
+  if (term != cadet_term[index]) {
+    cadet_term[index] = term;
+    cadet_learn_dirty = true;
+  }
+}
+
+// Called for every key event before it is handled
+static void cadet_watch(uint16_t keycode, keyrecord_t *record) {
+  uint8_t self = 0;
+
+  if (keycode >= CADET_FIRST && keycode <= CADET_LAST) {
+    self = 1 << (keycode - CADET_FIRST);
+  }
+  if (record->event.pressed) {
+    cadet_overlapped |= cadet_down & ~self;
+  }
+  else {
+    cadet_interrupted |= cadet_overlapped & cadet_down & ~self;
+  }
+}
+
+// Called on release with how long the cadet was down
+static void cadet_learn_sample(uint8_t index, uint16_t held) {
+  uint8_t bit = 1 << index;
+  uint8_t ms = held > 255 ? 255 : held;
+
+  if (cadet_interrupted & bit) {
+    cadet_dist_add(&cadet_learn[index].holds, ms);
+  }
+  else if (!(cadet_overlapped & bit) && held <= CADET_TERM_MAX) {
+    // Longer lone presses are cancelled holds as often as slow taps
+    cadet_dist_add(&cadet_learn[index].taps, ms);
+  }
+  cadet_term_update(index);
+}
+
+static void cadet_learn_init(void) {
+  if (eeprom_read_byte(CADET_EEPROM) == CADET_EEPROM_MAGIC) {
+    eeprom_read_block(cadet_learn, CADET_EEPROM + 1, sizeof(cadet_learn));
+  }
+  for (uint8_t i = 0; i < CADET_COUNT; i++) {
+    cadet_term_update(i);
+  }
+  cadet_learn_dirty = false;
+  cadet_save_timer = timer_read32();
+}
+
+// Forget everything learned; the terms fall back to their defaults
+static void cadet_learn_reset(void) {
+  for (uint8_t i = 0; i < CADET_COUNT; i++) {
+    cadet_learn[i] = (cadet_learn_t){ { 0 } };
+  }
+  eeprom_update_byte(CADET_EEPROM, 0xFF);
+  cadet_learn_init();
+}
+
+// Called once per scan from matrix_scan_user
+static void cadet_learn_task(void) {
+  if (!cadet_learn_dirty || timer_elapsed32(cadet_save_timer) < CADET_SAVE_DELAY) {
+    return;
+  }
+  eeprom_update_block(cadet_learn, CADET_EEPROM + 1, sizeof(cadet_learn));
+  eeprom_update_byte(CADET_EEPROM, CADET_EEPROM_MAGIC);
+  cadet_learn_dirty = false;
+  cadet_save_timer = timer_read32();
+}
+
+// The learned term, moved by whatever the cadet's own term setting has
+// been tuned away from its default
+static uint16_t cadet_term_get(uint8_t index) {
+  int16_t term = settings[SET_CADET_TERM_LCCO + index];
+
+  if (cadet_term[index]) {
+    term += cadet_term[index] - TAPPING_TERM;
+  }
+  if (term < CADET_TERM_MIN) {
+    return CADET_TERM_MIN;
+  }
+  if (term > CADET_TERM_MAX) {
+    return CADET_TERM_MAX;
+  }
+  return term;
+}
+
+static bool process_cadet(uint16_t keycode, keyrecord_t *record) {
+  uint8_t index = keycode - CADET_FIRST;
+  const cadet_t *cadet = &cadets[index];
+  uint8_t hold_mods = pgm_read_byte(&cadet->hold_mods);
+  uint16_t term = cadet_term_get(index);
+  uint16_t held;
+
+  if (record->event.pressed) {
+    cadet_timer[index] = timer_read();
+    cadet_down |= 1 << index;
+    cadet_overlapped &= ~(1 << index);
+    cadet_interrupted &= ~(1 << index);
+    register_mods(hold_mods);
+    return false;
+  }
+
+  held = timer_elapsed(cadet_timer[index]);
+  cadet_learn_sample(index, held);
+  cadet_down &= ~(1 << index);
+  // Dropping the hold mod rides along with the tap's first report
+  del_mods(hold_mods);
+  if (held < term && !cadet_permissive_hold(1 << index)) {
+    keystroke_tap(pgm_read_byte(&cadet->tap_mods), pgm_read_byte(&cadet->tap_key));
+  }
+  else {
+    keystroke_send();
+  }
+  return false;
+}
+
+// TAP DANCE
+// A dance key sends its tap key, or its double key when tapped twice within
+// SET_DANCE_TERM. It waits for a second tap only while nothing else happens:
+// any event from another key settles the dance as a single tap first, so
+// typing through a dance key costs nothing and the tap still lands before
+// the next key (or a modifier's release). Only a dance key followed by a
+// pause waits out the term. Held past the term or after settling, the key
+// stays down like any other, so holding X repeats x. While the leader is
+// recording, dance keys go to it like any other key.
+#define DANCE_NONE 0xFF
+
+typedef struct {
+  uint8_t tap_key;    // basic keycode for one tap
+  uint8_t double_key; // basic keycode for two taps
+} dance_t;
+
+// Adding a dance costs one keycode in custom_keycodes.h and one row here
+static const dance_t PROGMEM dances[DANCE_COUNT] = {
+  [TD_X_QUOT - DANCE_FIRST] = { KC_X, KC_QUOT },
+  [TD_V_MINS - DANCE_FIRST] = { KC_V, KC_MINS }
+};
+
+static uint8_t dance_pending = DANCE_NONE; // dance waiting for a second tap
+static bool dance_pending_down;
+static uint16_t dance_timer;
+// Code each dance key holds down once settled, 0 if none; released with it
+static uint8_t dance_held[DANCE_COUNT];
+
+static void dance_settle(void) {
+  uint8_t index = dance_pending;
+  uint8_t code = pgm_read_byte(&dances[index].tap_key);
+
+  dance_pending = DANCE_NONE;
+  if (dance_pending_down) {
+    keystroke_down(code);
+    keystroke_send();
+    dance_held[index] = code;
+  }
+  else {
+    keystroke_tap(0, code);
+  }
+}
+
+// Called for every key event before it is handled
+static void dance_watch(uint16_t keycode) {
+  if (dance_pending != DANCE_NONE && keycode != DANCE_FIRST + dance_pending) {
+    dance_settle();
+  }
+}
 
-// Stolen from https://docs.qmk.fm/leader_key.html
-LEADER_EXTERNS();
+// Called once per scan from matrix_scan_user
+static void dance_task(void) {
+  if (dance_pending != DANCE_NONE && timer_elapsed(dance_timer) >= settings[SET_DANCE_TERM]) {
+    dance_settle();
+  }
+}
 
-// Runs constantly in the background, in a loop.
-void matrix_scan_user(void) {
-  LEADER_DICTIONARY() {
-    leading = false;
-    leader_end();
-    SEQ_ONE_KEY(KC_S) {
-      register_mods(MOD_BIT(KC_LSFT));
-      register_code(KC_S);
-      unregister_code(KC_S);
-      unregister_mods(MOD_BIT(KC_LSFT));
-    }
-    SEQ_ONE_KEY(KC_W) {
-      // Reference: https://docs.qmk.fm/macros.html
-      action_macro_play(WMAX_MACRO);
+static bool process_dance(uint16_t keycode, keyrecord_t *record) {
+  uint8_t index = keycode - DANCE_FIRST;
+
+  if (!record->event.pressed) {
+    if (dance_pending == index) {
+      dance_pending_down = false;
+    }
+    else if (dance_held[index]) {
+      keystroke_up(dance_held[index]);
+      keystroke_send();
+      dance_held[index] = 0;
+    }
+    else {
+      return true; // pressed while the leader was recording
+    }
+    return false;
+  }
+  oneshot_used();
+  if (dance_pending == index) {
+    uint8_t code = pgm_read_byte(&dances[index].double_key);
+    dance_pending = DANCE_NONE;
+    keystroke_down(code);
+    keystroke_send();
+    dance_held[index] = code;
+    return false;
+  }
+  dance_pending = index;
+  dance_pending_down = true;
+  dance_timer = timer_read();
+  return false;
+}
+
+// COMBOS
+// Two keys pressed within SET_COMBO_TERM of each other send a third key
+// instead, held until either of them is released and shifted if shift is
+// down, so J+K is = and Shift+J+K is +. Each key that is part of a combo
+// gets a bit, and combo_results[] is indexed by the bits of the keys
+// pressed, so matching the second key is one table read. Keys that aren't
+// part of a combo leave at the switch in combo_bit().
+// The first key waits for the second only until the term runs out or
+// another key does something; then it goes down as itself, like a dance
+// key. While the leader is recording, combo keys are plain keys.
+#define COMBO_KEYS(X) X(KC_J) X(KC_K) X(KC_D) X(KC_F)
+
+// X(first, second, result)
+#define COMBOS(X)                  \
+  X(KC_J, KC_K, KC_EQL) /* =  + */ \
+  X(KC_D, KC_F, KC_GRV) /* `  ~ */
+
+enum combo_key_ids {
+#define COMBO_KEY_ID(code) COMBO_KEY_##code,
+  COMBO_KEYS(COMBO_KEY_ID)
+#undef COMBO_KEY_ID
+  COMBO_KEY_COUNT
+};
+
+#define COMBO_BIT(code) (1 << COMBO_KEY_##code)
+
+_Static_assert(COMBO_KEY_COUNT <= 8, "combo key bits must fit a byte");
+
+// Result keycode for each set of combo key bits, 0 where there is no combo
+static const uint8_t PROGMEM combo_results[1 << COMBO_KEY_COUNT] = {
+#define COMBO_RESULT(first, second, result) [COMBO_BIT(first) | COMBO_BIT(second)] = result,
+  COMBOS(COMBO_RESULT)
+#undef COMBO_RESULT
+};
+
+static uint8_t combo_pending;     // bit of the key waiting for a second one
+static uint8_t combo_pending_code;
+static uint16_t combo_timer;
+static uint8_t combo_down;        // bits of combo keys down as themselves
+static uint8_t combo_fired;       // bits of the keys behind combo_result
+static uint8_t combo_result;      // code held for the last combo, 0 if none
+
+static uint8_t combo_bit(uint16_t keycode) {
+  switch (keycode) {
+#define COMBO_KEY_CASE(code) case code: return COMBO_BIT(code);
+    COMBO_KEYS(COMBO_KEY_CASE)
+#undef COMBO_KEY_CASE
+  }
+  return 0;
+}
+
+static void combo_settle(void) {
+  keystroke_down(combo_pending_code);
+  keystroke_send();
+  combo_down |= combo_pending;
+  combo_pending = 0;
+}
+
+// Called for every key event before it is handled
+static void combo_watch(uint16_t keycode) {
+  if (combo_pending && !combo_bit(keycode)) {
+    combo_settle();
+  }
+}
+
+// Called once per scan from matrix_scan_user
+static void combo_task(void) {
+  if (combo_pending && timer_elapsed(combo_timer) >= settings[SET_COMBO_TERM]) {
+    combo_settle();
+  }
+}
+
+static bool process_combo(uint16_t keycode, uint8_t bit, keyrecord_t *record) {
+  uint8_t result;
+
+  if (!record->event.pressed) {
+    if (combo_fired & bit) {
+      combo_fired &= ~bit;
+      if (combo_result) {
+        keystroke_up(combo_result);
+        keystroke_send();
+        combo_result = 0;
+      }
+    }
+    else if (combo_pending == bit) {
+      combo_pending = 0;
+      keystroke_tap(0, keycode);
+    }
+    else if (combo_down & bit) {
+      combo_down &= ~bit;
+      keystroke_up(keycode);
+      keystroke_send();
+    }
+    else {
+      return true; // pressed while the leader was recording
+    }
+    return false;
+  }
+  oneshot_used();
+  if (combo_pending) {
+    result = pgm_read_byte(&combo_results[combo_pending | bit]);
+    if (result && !combo_result) {
+      combo_fired = combo_pending | bit;
+      combo_result = result;
+      combo_pending = 0;
+      keystroke_down(result);
+      keystroke_send();
+      return false;
+    }
+    combo_settle();
+  }
+  combo_pending = bit;
+  combo_pending_code = keycode;
+  combo_timer = timer_read();
+  return false;
+}
+
+// KEY REPEAT
+// With KEY_REPEAT_ENABLE the arrow and page keys repeat from here instead
+// of from the host, whose delay and rate differ from machine to machine.
+// A press is sent as a tap, so the host never sees a key held long enough
+// to start its own repeat. After SET_REPEAT_DELAY ms the key is tapped
+// again at SET_REPEAT_RATE taps/s, rising to SET_REPEAT_MAX over
+// SET_REPEAT_RAMP ms. Only the last key pressed repeats: its release or
+// any other key that isn't a modifier stops it, as the host's would.
+#ifdef KEY_REPEAT_ENABLE
+#define REPEAT_KEYS(X) \
+  X(KC_LEFT) X(KC_RGHT) X(KC_UP) X(KC_DOWN) X(KC_HOME) X(KC_END) X(KC_PGUP) X(KC_PGDN)
+
+static uint8_t repeat_code;    // key repeating, 0 if none
+static uint32_t repeat_start;  // first repeat, SET_REPEAT_DELAY after the press
+static uint32_t repeat_next;   // next repeat
+
+// Taps/s after repeating for held ms
+static uint16_t repeat_rate(uint32_t held) {
+  int16_t from = settings[SET_REPEAT_RATE];
+  int16_t to = settings[SET_REPEAT_MAX]; // may be tuned below from
+  uint16_t ramp = settings[SET_REPEAT_RAMP];
+
+  if (held >= ramp) {
+    return to;
+  }
+  return from + (int32_t)(to - from) * (int32_t)held / ramp;
+}
+
+// Called for every key event before it is handled
+static void repeat_watch(uint16_t keycode, keyrecord_t *record) {
+  if (repeat_code && record->event.pressed && keycode != repeat_code && !IS_MOD(keycode)) {
+    repeat_code = 0;
+  }
+}
+
+// Called once per scan from matrix_scan_user
+static void repeat_task(void) {
+  uint32_t now;
+
+  if (!repeat_code || (int32_t)((now = timer_read32()) - repeat_next) < 0) {
+    return;
+  }
+  repeat_next = now + 1000 / repeat_rate(now - repeat_start);
+  keystroke_tap(0, repeat_code);
+}
+
+static bool process_repeat(uint16_t keycode, keyrecord_t *record) {
+  if (!record->event.pressed) {
+    if (keycode == repeat_code) {
+      repeat_code = 0;
+    }
+    return false;
+  }
+  oneshot_used();
+  repeat_code = keycode;
+  repeat_start = timer_read32() + settings[SET_REPEAT_DELAY];
+  repeat_next = repeat_start;
+  keystroke_tap(0, keycode);
+  return false;
+}
+#else
+#define repeat_watch(keycode, record)
+#define repeat_task()
+#endif
+
+// MOUSE KEYS
+// The pointer keys on MDIA and NAV are handled here instead of by QMK's
+// mousekey.c. While a direction is held a report goes out every
+// MOUSE_INTERVAL ms, the mouse endpoint's USB poll interval, moving by the
+// current speed times the time since the last report. Speeds are in px/s
+// and follow mouse_curve[], one point per MOUSE_CURVE_STEP ms of holding,
+// interpolated in between. What is left of a pixel carries over to the
+// next report, so slow speeds still move evenly, and diagonals are scaled
+// by 1/sqrt(2) so they are no faster than straight moves. All integer.
+#ifndef MOUSE_INTERVAL
+#define MOUSE_INTERVAL 10
+#endif
+#ifndef MOUSE_CURVE_STEP
+#define MOUSE_CURVE_STEP 125
+#endif
+#define MOUSE_DIAGONAL 181 // 256 / sqrt(2)
+#define MOUSE_MAX_GAP 50   // ms; longer gaps between reports aren't made up
+
+// px/s after holding for 0, 1, 2, ... MOUSE_CURVE_STEPs; the last point holds
+static const uint16_t PROGMEM mouse_curve[] = {
+  120, 250, 500, 900, 1400, 1900, 2400
+};
+
+#define MOUSE_CURVE_POINTS (sizeof(mouse_curve) / sizeof(mouse_curve[0]))
+
+// Bit per KC_MS_U, KC_MS_D, KC_MS_L, KC_MS_R held
+#define MOUSE_DIR(keycode) (1 << ((keycode) - KC_MS_U))
+
+static uint8_t mouse_dirs;
+static uint8_t mouse_buttons;
+static uint32_t mouse_start; // first direction pressed
+static uint16_t mouse_timer; // last report
+static uint8_t mouse_frac;   // 1/256 px carried over
+
+static uint16_t mouse_speed(uint32_t held) {
+  uint32_t point = held / MOUSE_CURVE_STEP;
+  int16_t from, to;
+
+  if (point >= MOUSE_CURVE_POINTS - 1) {
+    return pgm_read_word(&mouse_curve[MOUSE_CURVE_POINTS - 1]);
+  }
+  from = pgm_read_word(&mouse_curve[point]);
+  to = pgm_read_word(&mouse_curve[point + 1]);
+  return from + (int32_t)(to - from) * (held % MOUSE_CURVE_STEP) / MOUSE_CURVE_STEP;
+}
+
+static int8_t mouse_axis(uint8_t minus, uint8_t plus) {
+  return !!(mouse_dirs & plus) - !!(mouse_dirs & minus);
+}
+
+static void mouse_send(uint8_t px) {
+  report_mouse_t report = { .buttons = mouse_buttons };
+
+  report.x = mouse_axis(MOUSE_DIR(KC_MS_L), MOUSE_DIR(KC_MS_R)) * px;
+  report.y = mouse_axis(MOUSE_DIR(KC_MS_U), MOUSE_DIR(KC_MS_D)) * px;
+  host_mouse_send(&report);
+}
+
+// Called once per scan from matrix_scan_user
+static void mouse_task(void) {
+  uint16_t gap;
+  uint32_t step;
+
+  if (!mouse_dirs || (gap = timer_elapsed(mouse_timer)) < MOUSE_INTERVAL) {
+    return;
+  }
+  mouse_timer = timer_read();
+  if (gap > MOUSE_MAX_GAP) {
+    gap = MOUSE_MAX_GAP;
+  }
+  step = (uint32_t)mouse_speed(timer_elapsed32(mouse_start)) * gap * 256 / 1000;
+  if (mouse_axis(MOUSE_DIR(KC_MS_L), MOUSE_DIR(KC_MS_R)) &&
+      mouse_axis(MOUSE_DIR(KC_MS_U), MOUSE_DIR(KC_MS_D))) {
+    step = step * MOUSE_DIAGONAL >> 8;
+  }
+  step += mouse_frac;
+  mouse_frac = step & 0xFF;
+  step >>= 8;
+  if (step) {
+    mouse_send(step > 127 ? 127 : step);
+  }
+}
+
+static bool process_mouse(uint16_t keycode, keyrecord_t *record) {
+  if (keycode >= KC_BTN1) {
+    uint8_t button = MOUSE_BTN1 << (keycode - KC_BTN1);
+    if (record->event.pressed) {
+      mouse_buttons |= button;
     }
-    SEQ_TWO_KEYS(KC_W,KC_LEFT) {
-      action_macro_play(WLEFT_MACRO);
+    else {
+      mouse_buttons &= ~button;
     }
-    SEQ_TWO_KEYS(KC_W,KC_RGHT) {
-      action_macro_play(WRGHT_MACRO);
+    mouse_send(0);
+    return false;
+  }
+  if (!record->event.pressed) {
+    mouse_dirs &= ~MOUSE_DIR(keycode);
+    return false;
+  }
+  if (!mouse_dirs) {
+    mouse_start = timer_read32();
+    mouse_frac = 0;
+  }
+  mouse_dirs |= MOUSE_DIR(keycode);
+  // A tap nudges one pixel; the curve takes over from the next interval
+  mouse_timer = timer_read();
+  mouse_send(1);
+  return false;
+}
+
+// STATS
+// Timing histograms kept in RAM and typed out, then cleared, by the Stats
+// key on SYMB as one line of hex ("ambi1 ..."); sim/ambi-stats decodes it.
+// Each histogram has 8 power of two buckets: bucket 0 is below 1 << shift,
+// bucket 7 is 64 << shift and up. Counts saturate at 0xFFFF.
+#ifdef STATS_ENABLE
+#ifdef __AVR__
+#include "timer_avr.h"
+#endif
+
+#define STATS_BUCKETS 8
+#define STATS_US_SHIFT 6 // <64us, <128us, ... >=4096us
+#define STATS_MS_SHIFT 2 // <4ms, <8ms, ... >=256ms
+#define STATS_VALUES (1 + 4 * (1 + STATS_BUCKETS))
+
+typedef struct {
+  uint16_t max;
+  uint16_t count[STATS_BUCKETS];
+} stats_hist_t;
+
+static stats_hist_t stats_loop;    // us from one matrix_scan_user to the next
+static stats_hist_t stats_scan;    // us inside matrix_scan_user
+static stats_hist_t stats_record;  // us inside process_record_user
+static stats_hist_t stats_age;     // ms a matrix event waited for process_record_user
+static uint16_t stats_rate;        // scans in the last whole second
+static uint16_t stats_scans;
+static uint16_t stats_window;
+static uint16_t stats_scan_start;
+static bool stats_started;
+static char stats_line[sizeof("ambi1 \n") + 4 * STATS_VALUES];
+
+// Microseconds, wrapping every 65 ms. On AVR the fraction of the current
+// ms comes from Timer0, which timer.c clears every TIMER_RAW_TOP counts;
+// elsewhere (the simulator) the resolution is 1 ms.
+static uint16_t stats_micros(void) {
+#ifdef TIMER_RAW
+  uint16_t ms;
+  uint8_t raw;
+  do {
+    ms = timer_read();
+    raw = TIMER_RAW;
+  } while (ms != timer_read());
+  return ms * 1000 + (uint16_t)((uint32_t)raw * 1000 / TIMER_RAW_TOP); // 16 bit int on AVR
+#else
+  return timer_read() * 1000;
+#endif
+}
+
+static void stats_add(stats_hist_t *hist, uint16_t value, uint8_t shift) {
+  uint8_t bucket = 0;
+
+  for (value >>= shift; value && bucket < STATS_BUCKETS - 1; value >>= 1) {
+    bucket++;
+  }
+  if (hist->count[bucket] != 0xFFFF) {
+    hist->count[bucket]++;
+  }
+}
+
+static void stats_sample(stats_hist_t *hist, uint16_t value, uint8_t shift) {
+  if (value > hist->max) {
+    hist->max = value;
+  }
+  stats_add(hist, value, shift);
+}
+
+static void stats_scan_begin(void) {
+  uint16_t now = stats_micros();
+
+  if (stats_started) {
+    stats_sample(&stats_loop, now - stats_scan_start, STATS_US_SHIFT);
+  }
+  stats_started = true;
+  stats_scan_start = now;
+  stats_scans++;
+  if (timer_elapsed(stats_window) >= 1000) {
+    stats_rate = stats_scans;
+    stats_scans = 0;
+    stats_window = timer_read();
+  }
+}
+
+static void stats_scan_end(void) {
+  stats_sample(&stats_scan, stats_micros() - stats_scan_start, STATS_US_SHIFT);
+}
+
+static char *stats_hex(char *out, uint16_t value) {
+  for (int8_t shift = 12; shift >= 0; shift -= 4) {
+    uint8_t digit = (value >> shift) & 0xF;
+    *out++ = digit < 10 ? '0' + digit : 'a' + digit - 10;
+  }
+  return out;
+}
+
+static char *stats_hist_hex(char *out, stats_hist_t *hist) {
+  out = stats_hex(out, hist->max);
+  for (uint8_t i = 0; i < STATS_BUCKETS; i++) {
+    out = stats_hex(out, hist->count[i]);
+  }
+  *hist = (stats_hist_t){ 0 };
+  return out;
+}
+
+// Types the counters and starts a fresh measurement. Ignored while the
+// player is busy, since stats_line may still be playing.
+static void stats_type(void) {
+  const char *prefix = "ambi1 ";
+  char *out = stats_line;
+
+  if (play_count) {
+    return;
+  }
+  while (*prefix) {
+    *out++ = *prefix++;
+  }
+  out = stats_hex(out, stats_rate);
+  out = stats_hist_hex(out, &stats_loop);
+  out = stats_hist_hex(out, &stats_scan);
+  out = stats_hist_hex(out, &stats_record);
+  out = stats_hist_hex(out, &stats_age);
+  *out++ = '\n';
+  *out = '\0';
+  play_ram_string(stats_line);
+}
+#else
+#define stats_scan_begin()
+#define stats_scan_end()
+#endif
+
+// TRACE RECORDER
+// With TRACE_ENABLE, every event reaching process_record_user is kept in a
+// ring of the last TRACE_EVENTS. The Trace key on SYMB types the ring,
+// oldest first, as "ambt1 <hex>" and empties it; events arriving while it
+// types are dropped so the dump stays consistent. Each event is 6 bytes,
+// little endian:
+//
+//   0-1  event.time, ms
+//   2    row << 4 | col << 1 | pressed
+//   3    layer_state & 0xFF
+//   4-5  keycode as resolved from the keymap
+//
+// Give the line to ambi-sim as a trace to replay it; it checks every
+// replayed record against the recorded keycode and layers.
+#ifdef TRACE_ENABLE
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 48
+#endif
+
+typedef struct {
+  uint16_t time;
+  uint8_t pos;
+  uint8_t layers;
+  uint16_t keycode;
+} trace_event_t;
+
+_Static_assert(sizeof(trace_event_t) == 6, "trace events are 6 packed bytes");
+
+static trace_event_t trace_ring[TRACE_EVENTS];
+static uint8_t trace_head; // oldest event
+static uint8_t trace_count;
+static bool trace_dumping;
+
+static void trace_record(uint16_t keycode, keyrecord_t *record) {
+  trace_event_t *event;
+
+  if (trace_dumping) {
+    if (play_count) {
+      return;
     }
-    SEQ_TWO_KEYS(KC_C, KC_C) {
-      register_mods(MOD_BIT(KC_LALT));
-      register_code(KC_X);
-      unregister_code(KC_X);
-      unregister_mods(MOD_BIT(KC_LALT));
-      SEND_STRING("cider-connect");
-      register_code(KC_ENT);
-      unregister_code(KC_ENT);
+    trace_dumping = false;
+    trace_head = 0;
+    trace_count = 0;
+  }
+  if (trace_count < TRACE_EVENTS) {
+    event = &trace_ring[(trace_head + trace_count++) % TRACE_EVENTS];
+  }
+  else {
+    event = &trace_ring[trace_head];
+    trace_head = (trace_head + 1) % TRACE_EVENTS;
+  }
+  event->time = record->event.time;
+  event->pos = record->event.key.row << 4 | record->event.key.col << 1 | record->event.pressed;
+  event->layers = layer_state;
+  event->keycode = keycode;
+}
+
+// Needs the whole play queue: the prefix, up to two runs of the ring and
+// the newline
+static void trace_dump(void) {
+  uint8_t first = trace_count < TRACE_EVENTS - trace_head ? trace_count : TRACE_EVENTS - trace_head;
+
+  if (play_count || trace_dumping) {
+    return;
+  }
+  trace_dumping = true;
+  play_string(PSTR("ambt1 "));
+  play_ram_hex(&trace_ring[trace_head], first * sizeof(trace_event_t));
+  play_ram_hex(&trace_ring[0], (trace_count - first) * sizeof(trace_event_t));
+  play_string(PSTR("\n"));
+}
+#else
+#define trace_record(keycode, record)
+#endif
+
+static bool process_record_keymap(uint16_t keycode, keyrecord_t *record) {
+  uint8_t combo;
+
+  dm_watch(keycode, record);
+  dance_watch(keycode);
+  combo_watch(keycode);
+  repeat_watch(keycode, record);
+  cadet_watch(keycode, record);
+  combo = combo_bit(keycode);
+  if (combo && (!leading || !record->event.pressed)) {
+    return process_combo(keycode, combo, record);
+  }
+  switch (keycode) {
+    // dynamically generate these.
+    case EPRM:
+      if (record->event.pressed) {
+        eeconfig_init();
+        cadet_learn_reset();
+        settings_reset();
+        #ifdef RAW_ENABLE
+          overlay_clear();
+        #endif
+      }
+      return false;
+      break;
+    case VRSN:
+      if (record->event.pressed) {
+        play_string(PSTR(QMK_KEYBOARD "/" QMK_KEYMAP " @ " QMK_VERSION));
+      }
+      return false;
+      break;
+    case RGB_SLD:
+      if (record->event.pressed) {
+        #ifdef RGBLIGHT_ENABLE
+          rgblight_mode(1);
+        #endif
+      }
+      return false;
+      break;
+    case STAT:
+      if (record->event.pressed) {
+        #ifdef STATS_ENABLE
+          stats_type();
+        #endif
+      }
+      return false;
+    case TRCE:
+      if (record->event.pressed) {
+        #ifdef TRACE_ENABLE
+          trace_dump();
+        #endif
+      }
+      return false;
+    case TUNE:
+    case TUNE_UP:
+    case TUNE_DN:
+      if (record->event.pressed) {
+        settings_tune(keycode == TUNE_UP ? 1 : keycode == TUNE_DN ? -1 : 0);
+      }
+      return false;
+    // Ignored while the player is busy, which may be playing dm_buffer
+    case DM_REC:
+      if (record->event.pressed && !play_count) {
+        if (dm_recording) {
+          dm_stop();
+        }
+        else {
+          dm_start();
+        }
+      }
+      return false;
+    case DM_PLAY:
+      if (record->event.pressed && !dm_recording) {
+        play_recording(dm_buffer, dm_len);
+      }
+      return false;
+    case CADET_FIRST ... CADET_LAST:
+      return process_cadet(keycode, record);
+    case DANCE_FIRST ... DANCE_LAST:
+      if (!leading || !record->event.pressed) {
+        return process_dance(keycode, record);
+      }
+      break;
+    case KC_MS_U ... KC_MS_R:
+    case KC_BTN1 ... KC_BTN5:
+      return process_mouse(keycode, record);
+#ifdef KEY_REPEAT_ENABLE
+#define REPEAT_KEY_CASE(code) case code:
+    REPEAT_KEYS(REPEAT_KEY_CASE)
+#undef REPEAT_KEY_CASE
+      if (!leading || !record->event.pressed) {
+        return process_repeat(keycode, record);
+      }
+      break;
+#endif
+  }
+  if (record->event.pressed && leader_track(keycode)) {
+    return false;
+  }
+  return true;
+}
+
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+  bool result;
+
+  trace_record(keycode, record);
+#ifdef STATS_ENABLE
+  uint16_t start = stats_micros();
+
+  stats_sample(&stats_age, timer_elapsed(record->event.time), STATS_MS_SHIFT);
+  result = process_record_keymap(keycode, record);
+  stats_sample(&stats_record, stats_micros() - start, STATS_US_SHIFT);
+#else
+  result = process_record_keymap(keycode, record);
+#endif
+  if (result) {
+    dm_passed(keycode);
+  }
+  return result;
+}
+
+// LAYER INDICATORS
+// Everything that reflects the active layer hangs off layer_indicators_changed,
+// which matrix_scan_user only calls when layer_state changes, so a
+// steady-state scan does no LED I/O.
+
+static const uint8_t PROGMEM layer_leds[LAYER_COUNT] = {
+#define LAYER_LEDS(name, leds, hue, text) [name] = (leds),
+  LAYERS(LAYER_LEDS)
+#undef LAYER_LEDS
+};
+
+static uint32_t indicator_layer_state;
+static uint8_t indicator_leds; // LAYER_LED_* bits currently lit
+
+static void indicator_leds_update(uint8_t layer) {
+  uint8_t leds = pgm_read_byte(&layer_leds[layer]);
+  uint8_t changed = leds ^ indicator_leds;
+
+  if (changed & LAYER_LED_BOARD) {
+    if (leds & LAYER_LED_BOARD) {
+      ergodox_board_led_on();
     }
-    SEQ_TWO_KEYS(KC_A, KC_S) {
-      register_code(KC_H);
-      unregister_code(KC_H);
+    else {
+      ergodox_board_led_off();
     }
-    SEQ_THREE_KEYS(KC_A, KC_S, KC_D) {
-      register_code(KC_LGUI);
-      register_code(KC_S);
-      unregister_code(KC_S);
-      unregister_code(KC_LGUI);
+  }
+  for (uint8_t i = 1; i <= 3; i++) {
+    if (changed & LAYER_LED(i)) {
+      if (leds & LAYER_LED(i)) {
+        ergodox_right_led_on(i);
+      }
+      else {
+        ergodox_right_led_off(i);
+      }
     }
   }
+  indicator_leds = leds;
+}
+
+static void layer_indicators_changed(void) {
+  uint8_t layer = biton32(indicator_layer_state);
+
+  // LT(ALL_T(KC_NO), ...) and friends can set bits past the last layer
+  if (layer >= LAYER_COUNT) {
+    layer = BASE;
+  }
+  indicator_leds_update(layer);
+}
+
+static void layer_indicators_sync(void) {
+  indicator_layer_state = layer_state;
+  layer_indicators_changed();
+}
+
+// BOOT ANIMATION
+// The power-up LED fade is stepped from matrix_scan_user instead of
+// blocking in wait_ms, so the matrix is scanned from the first millisecond.
+enum boot_fade_phases {
+  BOOT_DIM,   // LED_BRIGHTNESS_HI down to LED_BRIGHTNESS_LO, 5 ms per step
+  BOOT_HOLD,  // 1 s at LED_BRIGHTNESS_LO
+  BOOT_FADE,  // LED_BRIGHTNESS_LO down to off, 10 ms per step
+  BOOT_OFF,
+  BOOT_DONE
+};
+
+static uint8_t boot_phase = BOOT_DONE;
+static uint8_t boot_level;
+static uint16_t boot_timer;
+static uint16_t boot_delay; // ms until the next step
+
+static void boot_fade_task(void) {
+  if (timer_elapsed(boot_timer) < boot_delay) {
+    return;
+  }
+  boot_timer = timer_read();
+  switch (boot_phase) {
+    case BOOT_DIM:
+      ergodox_led_all_set(boot_level);
+      boot_delay = 5;
+      if (--boot_level == LED_BRIGHTNESS_LO) {
+        boot_phase = BOOT_HOLD;
+      }
+      break;
+    case BOOT_HOLD:
+      boot_delay = 1000;
+      boot_phase = BOOT_FADE;
+      break;
+    case BOOT_FADE:
+      ergodox_led_all_set(boot_level);
+      boot_delay = 10;
+      if (--boot_level == 0) {
+        boot_phase = BOOT_OFF;
+      }
+      break;
+    case BOOT_OFF:
+      ergodox_led_all_off();
+      boot_phase = BOOT_DONE;
+      // Hand the LEDs back to the layer indicators
+      indicator_leds = 0;
+      layer_indicators_sync();
+      break;
+  }
+}
+
+// Runs just one time when the keyboard initializes.
+void matrix_init_user(void) {
+  ergodox_led_all_on();
+  boot_level = LED_BRIGHTNESS_HI;
+  boot_phase = BOOT_DIM;
+  boot_delay = 0;
+  boot_timer = timer_read();
+  settings_init();
+  cadet_learn_init();
+#ifdef RAW_ENABLE
+  overlay_init();
+#endif
+};
+
+// Runs constantly in the background, in a loop.
+void matrix_scan_user(void) {
+  stats_scan_begin();
+  dm_capture(); // reports QMK sent for the last event
+
+  if (leading && timer_elapsed(leader_time) > settings[SET_LEADER_TIMEOUT]) {
+    leader_finish();
+  }
   
-  uint8_t layer = biton32(layer_state);
-
-  ergodox_board_led_off();
-  ergodox_right_led_1_off();
-  ergodox_right_led_2_off();
-  ergodox_right_led_3_off();
-  switch (layer) {
-    // TODO: Make this relevant to the ErgoDox EZ.
-      case 1:
-          ergodox_right_led_1_on();
-          break;
-      case 2:
-          ergodox_right_led_2_on();
-          break;
-      default:
-          // none
-          break;
+  play_task();
+  dance_task();
+  combo_task();
+  repeat_task();
+  mouse_task();
+  oneshot_timeout_task();
+  cadet_learn_task();
+  settings_task();
+  overlay_task();
+
+  if (boot_phase != BOOT_DONE) {
+    boot_fade_task();
   }
+  else if (layer_state != indicator_layer_state) {
+    layer_indicators_sync();
+  }
+
+  stats_scan_end();
 };
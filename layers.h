@@ -0,0 +1,28 @@
+#ifndef AMBI_MACS_LAYERS_H
+#define AMBI_MACS_LAYERS_H
+
+// Indicator LEDs lit while a layer is the highest active one
+#define LAYER_LED_BOARD (1 << 0)
+#define LAYER_LED(n) (1 << (n)) // right LED 1..3
+
+// Every layer and what it looks like on the indicators. keymap.c and
+// visualizer.c both expand this list, so the LEDs, the LCD and the keymap
+// can't disagree about which layer is which.
+//
+// X(name, leds, lcd hue, lcd text)
+#define LAYERS(X)                                                  \
+  X(BASE, 0,            84,  "Default")       /* default layer */ \
+  X(ALPH, LAYER_LED(1), 42,  "Alpha")         /* alpha layer */   \
+  X(MDIA, LAYER_LED(2), 0,   "Media & Mouse") /* media layer */   \
+  X(SYMB, 0,            168, "Symbol")        /* symbols */       \
+  X(NAV,  0,            126, "Nav")           /* nav layer with OS+Emacs bindings */ \
+  X(FN,   0,            210, "Fn")            /* varous FNs */
+
+enum layers {
+#define LAYER_ENUM(name, leds, hue, text) name,
+  LAYERS(LAYER_ENUM)
+#undef LAYER_ENUM
+  LAYER_COUNT
+};
+
+#endif
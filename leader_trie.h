@@ -0,0 +1,48 @@
+// Generated by sim/leader_trie from leader.def; do not edit.
+// Regenerate with: make -C sim leader_trie
+
+#define LEADER_TRIE_SEQ_COUNT 14
+#define LEADER_TRIE_DEF_CKSUM 1320801695
+
+static const leader_node_t PROGMEM leader_nodes[] = {
+  {   0, 6, LEADER_NONE }, //  0: LEAD
+  {   0, 0, LA_SHIFT_S  }, //  1: LEAD S (prefix-free, runs on its last key)
+  {   6, 2, LA_WMAX     }, //  2: LEAD W
+  {   8, 3, LEADER_NONE }, //  3: LEAD C
+  {  11, 1, LEADER_NONE }, //  4: LEAD N
+  {  12, 4, LEADER_NONE }, //  5: LEAD R
+  {  16, 1, LEADER_NONE }, //  6: LEAD A
+  {   0, 0, LA_WLEFT    }, //  7: LEAD W LEFT (prefix-free, runs on its last key)
+  {   0, 0, LA_WRGHT    }, //  8: LEAD W RGHT (prefix-free, runs on its last key)
+  {   0, 0, LA_CIDER    }, //  9: LEAD C C (prefix-free, runs on its last key)
+  {   0, 0, LA_CIDER_JACK_IN }, // 10: LEAD C J (prefix-free, runs on its last key)
+  {   0, 0, LA_COMMENT  }, // 11: LEAD C O (prefix-free, runs on its last key)
+  {   0, 0, LA_NS       }, // 12: LEAD N S (prefix-free, runs on its last key)
+  {   0, 0, LA_REPL_REQUIRE }, // 13: LEAD R R (prefix-free, runs on its last key)
+  {   0, 0, LA_REPL_PST }, // 14: LEAD R E (prefix-free, runs on its last key)
+  {   0, 0, LA_REPL_PPRINT }, // 15: LEAD R P (prefix-free, runs on its last key)
+  {   0, 0, LA_REPL_DOC }, // 16: LEAD R D (prefix-free, runs on its last key)
+  {  17, 1, LA_AS       }, // 17: LEAD A S
+  {   0, 0, LA_ASD      }, // 18: LEAD A S D (prefix-free, runs on its last key)
+};
+
+static const leader_edge_t PROGMEM leader_edges[] = {
+  { KC_S,      1 }, // LEAD S
+  { KC_W,      2 }, // LEAD W
+  { KC_C,      3 }, // LEAD C
+  { KC_N,      4 }, // LEAD N
+  { KC_R,      5 }, // LEAD R
+  { KC_A,      6 }, // LEAD A
+  { KC_LEFT,   7 }, // LEAD W LEFT
+  { KC_RGHT,   8 }, // LEAD W RGHT
+  { KC_C,      9 }, // LEAD C C
+  { KC_J,     10 }, // LEAD C J
+  { KC_O,     11 }, // LEAD C O
+  { KC_S,     12 }, // LEAD N S
+  { KC_R,     13 }, // LEAD R R
+  { KC_E,     14 }, // LEAD R E
+  { KC_P,     15 }, // LEAD R P
+  { KC_D,     16 }, // LEAD R D
+  { KC_S,     17 }, // LEAD A S
+  { KC_D,     18 }, // LEAD A S D
+};
@@ -0,0 +1,39 @@
+#ifndef AMBI_MACS_OVERLAY_H
+#define AMBI_MACS_OVERLAY_H
+
+// Raw HID protocol for the keymap overlay (KEYMAP OVERLAY in keymap.c).
+// sim/ambi-patch is the host side. Every packet is OVERLAY_HID_SIZE bytes,
+// both ways; a reply repeats the command byte and then gives a status.
+// Keycodes are little endian, positions are matrix row and col.
+#define OVERLAY_HID_SIZE 32 // QMK's RAW_EPSIZE
+#define OVERLAY_HID_VERSION 1
+#define OVERLAY_CAPACITY 32 // overrides kept, 4 bytes of RAM and EEPROM each
+
+enum overlay_commands {
+  OVERLAY_INFO = 1, // -> 'a' 'm' 'b' 'o', version, capacity, count, layers, rows, cols
+  OVERLAY_GET,      // layer, row, col -> keycode lo, hi, 1 if overridden
+  OVERLAY_SET,      // layer, row, col, keycode lo, hi
+  OVERLAY_DEL,      // layer, row, col
+  OVERLAY_LIST,     // first -> count, then up to OVERLAY_LIST_MAX entries from first
+  OVERLAY_CLEAR
+};
+
+enum overlay_status {
+  OVERLAY_OK,
+  OVERLAY_BAD_ARGS,  // layer or position outside the keymap, no such override, or a
+                     // packet shorter than OVERLAY_HID_SIZE
+  OVERLAY_FULL,
+  OVERLAY_UNKNOWN    // not a command this version knows
+};
+
+// As stored in RAM and EEPROM and sent by OVERLAY_LIST
+typedef struct {
+  uint8_t layer;
+  uint8_t pos; // row << 3 | col
+  uint8_t keycode[2];
+} overlay_entry_t;
+
+#define OVERLAY_POS(row, col) ((row) << 3 | (col))
+#define OVERLAY_LIST_MAX ((OVERLAY_HID_SIZE - 3) / sizeof(overlay_entry_t))
+
+#endif
@@ -0,0 +1,220 @@
+/* ambi-patch: rebind keys on the running keyboard through the keymap
+ * overlay, without reflashing.
+ *
+ *   ambi-patch info
+ *   ambi-patch list
+ *   ambi-patch get <layer> <row> <col>
+ *   ambi-patch set <layer> <row> <col> <keycode>
+ *   ambi-patch del <layer> <row> <col>
+ *   ambi-patch clear
+ *
+ * Layers are named as in ../layers.h (BASE, SYMB, ...) or numbered. Rows
+ * and cols are matrix positions as in the sim traces, so J on BASE is
+ * "BASE 9 2". Keycodes are QMK's 16 bit values, e.g. 0x14 for KC_Q; get
+ * prints what the layer has there now, 0x0001 being KC_TRNS.
+ *
+ * The keyboard is the first raw HID interface (usage page 0xFF60, usage
+ * 0x61) that answers OVERLAY_INFO as this keymap; the protocol is in
+ * ../overlay.h. Changes take effect at once and reach EEPROM a second
+ * after the last one.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <hidapi.h>
+#include "../layers.h"
+#include "../overlay.h"
+
+#define RAW_USAGE_PAGE 0xFF60
+#define RAW_USAGE 0x61
+#define REPLY_TIMEOUT 1000 // ms
+
+static const char *layer_names[] = {
+#define LAYER_NAME(name, leds, hue, text) #name,
+  LAYERS(LAYER_NAME)
+#undef LAYER_NAME
+};
+
+static hid_device *device;
+static uint8_t info[OVERLAY_HID_SIZE]; // the keyboard's OVERLAY_INFO reply
+
+// Sends one command and reads its reply; 0 when one came back
+static int transact(hid_device *dev, const uint8_t *command, uint8_t *reply) {
+  uint8_t out[OVERLAY_HID_SIZE + 1] = { 0 }; // report ID 0 first
+  int got;
+
+  memcpy(out + 1, command, OVERLAY_HID_SIZE);
+  if (hid_write(dev, out, sizeof(out)) < 0) {
+    return -1;
+  }
+  do {
+    got = hid_read_timeout(dev, reply, OVERLAY_HID_SIZE, REPLY_TIMEOUT);
+  } while (got > 0 && reply[0] != command[0]); // a reply left over from before
+  return got > 0 ? 0 : -1;
+}
+
+static void open_keyboard(void) {
+  struct hid_device_info *all = hid_enumerate(0, 0);
+  struct hid_device_info *at;
+  uint8_t command[OVERLAY_HID_SIZE] = { OVERLAY_INFO };
+
+  for (at = all; at && !device; at = at->next) {
+    hid_device *dev;
+    if (at->usage_page != RAW_USAGE_PAGE || at->usage != RAW_USAGE ||
+        !(dev = hid_open_path(at->path))) {
+      continue;
+    }
+    if (!transact(dev, command, info) && info[1] == OVERLAY_OK && !memcmp(&info[2], "ambo", 4)) {
+      device = dev;
+    }
+    else {
+      hid_close(dev);
+    }
+  }
+  hid_free_enumeration(all);
+  if (!device) {
+    fprintf(stderr, "no keyboard with the keymap overlay found (RAW_ENABLE = yes?)\n");
+    exit(1);
+  }
+  if (info[6] != OVERLAY_HID_VERSION) {
+    fprintf(stderr, "keyboard speaks overlay protocol %u, this is %u\n", info[6], OVERLAY_HID_VERSION);
+    exit(1);
+  }
+}
+
+static void command(uint8_t *packet, uint8_t *reply) {
+  static const char *const errors[] = {
+    [OVERLAY_BAD_ARGS] = "no such key or override",
+    [OVERLAY_FULL] = "overlay full, del or clear some overrides first",
+    [OVERLAY_UNKNOWN] = "command not known to the keyboard",
+  };
+
+  if (transact(device, packet, reply)) {
+    fprintf(stderr, "no reply from the keyboard\n");
+    exit(1);
+  }
+  if (reply[1] != OVERLAY_OK) {
+    fprintf(stderr, "%s\n", reply[1] <= OVERLAY_UNKNOWN ? errors[reply[1]] : "failed");
+    exit(1);
+  }
+}
+
+static unsigned parse_number(const char *arg, unsigned limit, const char *what) {
+  char *end;
+  unsigned long value = strtoul(arg, &end, 0);
+
+  if (!*arg || *end || value >= limit) {
+    fprintf(stderr, "bad %s '%s'\n", what, arg);
+    exit(2);
+  }
+  return value;
+}
+
+static uint8_t parse_layer(const char *arg) {
+  for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+    if (!strcasecmp(arg, layer_names[i])) {
+      return i;
+    }
+  }
+  return parse_number(arg, info[9], "layer");
+}
+
+static const char *layer_name(uint8_t layer) {
+  return layer < LAYER_COUNT ? layer_names[layer] : "?";
+}
+
+// layer, row and col from argv into packet[1..3]
+static void parse_key(char **argv, uint8_t *packet) {
+  packet[1] = parse_layer(argv[0]);
+  packet[2] = parse_number(argv[1], info[10], "row");
+  packet[3] = parse_number(argv[2], info[11], "col");
+}
+
+static void list(void) {
+  uint8_t packet[OVERLAY_HID_SIZE] = { OVERLAY_LIST };
+  uint8_t reply[OVERLAY_HID_SIZE];
+  unsigned first = 0, count;
+
+  do {
+    packet[1] = first;
+    command(packet, reply);
+    count = reply[2];
+    for (unsigned i = 0; i < OVERLAY_LIST_MAX && first < count; i++, first++) {
+      const overlay_entry_t *entry = (const overlay_entry_t *)&reply[3] + i;
+      printf("%-4s %2u %u  0x%04X\n", layer_name(entry->layer), entry->pos >> 3, entry->pos & 7,
+             entry->keycode[0] | entry->keycode[1] << 8);
+    }
+  } while (first < count);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s info | list | clear\n"
+                  "       %s get <layer> <row> <col>\n"
+                  "       %s set <layer> <row> <col> <keycode>\n"
+                  "       %s del <layer> <row> <col>\n",
+          argv0, argv0, argv0, argv0);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  uint8_t packet[OVERLAY_HID_SIZE] = { 0 };
+  uint8_t reply[OVERLAY_HID_SIZE];
+  const char *verb = argc > 1 ? argv[1] : "";
+  unsigned keycode;
+
+  if (!strcmp(verb, "info") || !strcmp(verb, "list") || !strcmp(verb, "clear")) {
+    if (argc != 2) usage(argv[0]);
+  }
+  else if (!strcmp(verb, "get") || !strcmp(verb, "del")) {
+    if (argc != 5) usage(argv[0]);
+  }
+  else if (!strcmp(verb, "set")) {
+    if (argc != 6) usage(argv[0]);
+  }
+  else {
+    usage(argv[0]);
+  }
+
+  if (hid_init()) {
+    fprintf(stderr, "hidapi failed to start\n");
+    return 1;
+  }
+  open_keyboard();
+
+  if (!strcmp(verb, "info")) {
+    printf("overlay protocol %u, %u of %u overrides, %u layers, %ux%u matrix\n",
+           info[6], info[8], info[7], info[9], info[10], info[11]);
+  }
+  else if (!strcmp(verb, "list")) {
+    list();
+  }
+  else if (!strcmp(verb, "clear")) {
+    packet[0] = OVERLAY_CLEAR;
+    command(packet, reply);
+  }
+  else if (!strcmp(verb, "get")) {
+    packet[0] = OVERLAY_GET;
+    parse_key(argv + 2, packet);
+    command(packet, reply);
+    printf("0x%04X%s\n", reply[2] | reply[3] << 8, reply[4] ? " (overlay)" : "");
+  }
+  else if (!strcmp(verb, "set")) {
+    packet[0] = OVERLAY_SET;
+    parse_key(argv + 2, packet);
+    keycode = parse_number(argv[5], 0x10000, "keycode");
+    packet[4] = keycode & 0xFF;
+    packet[5] = keycode >> 8;
+    command(packet, reply);
+  }
+  else {
+    packet[0] = OVERLAY_DEL;
+    parse_key(argv + 2, packet);
+    command(packet, reply);
+  }
+
+  hid_close(device);
+  hid_exit();
+  return 0;
+}
@@ -0,0 +1,151 @@
+/* ambi-stats: decode the line the Stats key types.
+ *
+ *   ambi1 <rate><loop><scan><record><age>
+ *
+ * Every value is 4 lowercase hex digits. rate is scans in the last whole
+ * second; each histogram is its max followed by 8 bucket counts, where
+ * bucket 0 is below 1 << shift, bucket n covers [1 << (shift + n - 1),
+ * 1 << (shift + n)) and bucket 7 is everything from 64 << shift up. The
+ * shifts and units below must match keymap.c's STATS section.
+ *
+ * Reads the files named on the command line, or stdin, and decodes every
+ * line containing "ambi1 ", so hid_listen output or a paste from an
+ * editor both work.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BUCKETS 8
+#define VALUES (1 + 4 * (1 + BUCKETS))
+
+typedef struct {
+  const char *name;
+  const char *unit;
+  unsigned shift;
+} hist_info_t;
+
+static const hist_info_t hists[] = {
+  { "scan loop", "us", 6 },             // matrix_scan_user to matrix_scan_user
+  { "matrix_scan_user", "us", 6 },
+  { "process_record_user", "us", 6 },
+  { "event age at record", "ms", 2 },   // matrix event to process_record_user
+};
+
+static void bucket_range(unsigned shift, int bucket, char *out, size_t size) {
+  unsigned low = bucket ? 1u << (shift + bucket - 1) : 0;
+  unsigned high = 1u << (shift + bucket);
+  if (bucket == BUCKETS - 1) {
+    snprintf(out, size, ">= %u", low);
+  }
+  else {
+    snprintf(out, size, "%u-%u", low, high - 1);
+  }
+}
+
+static void print_hist(const hist_info_t *info, const uint16_t *values) {
+  uint32_t total = 0;
+  uint32_t seen = 0;
+  uint16_t peak = 0;
+  int p50 = -1, p99 = -1;
+  int i;
+
+  for (i = 0; i < BUCKETS; i++) {
+    total += values[1 + i];
+    peak = values[1 + i] > peak ? values[1 + i] : peak;
+  }
+  printf("%s (%s): %u samples, max %u\n", info->name, info->unit, total, values[0]);
+  for (i = 0; i < BUCKETS; i++) {
+    char range[32];
+    uint16_t count = values[1 + i];
+    int bar = peak ? (count * 40 + peak - 1) / peak : 0;
+    seen += count;
+    if (p50 < 0 && seen * 2 >= total && total) {
+      p50 = i;
+    }
+    if (p99 < 0 && seen * 100 >= total * 99 && total) {
+      p99 = i;
+    }
+    bucket_range(info->shift, i, range, sizeof(range));
+    printf("  %-12s %6u%s", range, count, count == 0xFFFF ? "+" : "");
+    if (bar) {
+      printf(" %.*s", bar, "########################################");
+    }
+    putchar('\n');
+  }
+  if (total) {
+    char range[32];
+    bucket_range(info->shift, p50, range, sizeof(range));
+    printf("  p50 in %s", range);
+    bucket_range(info->shift, p99, range, sizeof(range));
+    printf(", p99 in %s %s\n", range, info->unit);
+  }
+}
+
+static int decode(const char *line) {
+  uint16_t values[VALUES];
+  const char *p = strstr(line, "ambi1 ");
+  int i;
+
+  if (!p) {
+    return 0;
+  }
+  p += strlen("ambi1 ");
+  for (i = 0; i < VALUES; i++) {
+    unsigned value;
+    if (sscanf(p, "%4x", &value) != 1 || strspn(p, "0123456789abcdef") < 4) {
+      fprintf(stderr, "ambi-stats: truncated line, expected %d hex values\n", VALUES);
+      return -1;
+    }
+    values[i] = value;
+    p += 4;
+  }
+
+  printf("scan rate: %u scans/s\n", values[0]);
+  for (i = 0; i < 4; i++) {
+    print_hist(&hists[i], &values[1 + i * (1 + BUCKETS)]);
+  }
+  return 1;
+}
+
+static int decode_file(FILE *in) {
+  char line[1024];
+  int found = 0;
+  while (fgets(line, sizeof(line), in)) {
+    int result = decode(line);
+    if (result < 0) {
+      return -1;
+    }
+    if (result && found++) {
+      putchar('\n');
+    }
+  }
+  return found;
+}
+
+int main(int argc, char **argv) {
+  int found = 0;
+  int i;
+
+  if (argc < 2) {
+    found = decode_file(stdin);
+  }
+  for (i = 1; i < argc && found >= 0; i++) {
+    FILE *in = fopen(argv[i], "r");
+    int result;
+    if (!in) {
+      perror(argv[i]);
+      return 1;
+    }
+    result = decode_file(in);
+    found = result < 0 ? -1 : found + result;
+    fclose(in);
+  }
+  if (found <= 0) {
+    if (!found) {
+      fprintf(stderr, "ambi-stats: no \"ambi1 \" line found\n");
+    }
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+/* POSIX cksum of a .def file, for the generators to stamp into the header
+ * they write. The keymap Makefile runs cksum(1) on the same file and
+ * keymap.c checks the two match, so a header left behind by an edit to
+ * its .def fails the build instead of flashing the old table.
+ */
+#ifndef SIM_DEF_CKSUM_H
+#define SIM_DEF_CKSUM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint32_t cksum_byte(uint32_t crc, uint8_t byte) {
+  crc ^= (uint32_t)byte << 24;
+  for (int i = 0; i < 8; i++) {
+    crc = crc & 0x80000000 ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+  }
+  return crc;
+}
+
+// Exits (1) if path can't be read
+static uint32_t def_cksum(const char *path) {
+  FILE *f = fopen(path, "rb");
+  uint32_t crc = 0;
+  unsigned long len = 0;
+  int c;
+
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  while ((c = getc(f)) != EOF) {
+    crc = cksum_byte(crc, c);
+    len++;
+  }
+  fclose(f);
+  for (; len; len >>= 8) {
+    crc = cksum_byte(crc, len & 0xFF);
+  }
+  return ~crc;
+}
+
+#endif
@@ -0,0 +1,7 @@
+/* Compiles keymap.c as-is and exposes what the stub core can't see through
+ * an extern declaration, such as how many layers the keymap defines.
+ */
+#include "../keymap.c"
+
+// Not sizeof(keymaps): derived layers such as ALPH have no slot there
+const uint8_t sim_keymap_layers = LAYER_COUNT;
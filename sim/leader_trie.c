@@ -0,0 +1,209 @@
+/* leader_trie: build ../leader_trie.h from ../leader.def.
+ *
+ * Each prefix of a leader sequence becomes a trie node; a node's outgoing
+ * edges are stored contiguously so the firmware can step from one node to
+ * the next with a short scan of that node's edges as each key arrives.
+ *
+ * Keycode values come from the stub headers in qmk/, which mirror QMK's,
+ * so equal keycodes compare equal here exactly as they do in the firmware.
+ * The emitted header uses the keycode names from leader.def, not values.
+ *
+ * Sequence ends with no outgoing edges are prefix-free; the firmware runs
+ * them as soon as their last key is pressed instead of after the timeout.
+ *
+ * The header carries the cksum of leader.def it was built from, which
+ * keymap.c checks against the file at build time.
+ *
+ * Fails (exit 1) on empty, duplicate or unreachable sequences.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qmk.h"
+#include "def_cksum.h"
+
+#define LEADER_MAX_KEYS 5 // size of QMK's leader_sequence[]
+#define MAX_NODES 255
+#define MAX_NAME 32
+
+typedef struct {
+  const char *action;
+  const char *names; // "KC_W, KC_LEFT"
+  uint16_t keys[LEADER_MAX_KEYS + 2];
+} seq_t;
+
+static const seq_t seqs[] = {
+#define LEADER_SEQ(action, ...) { #action, #__VA_ARGS__, { __VA_ARGS__, KC_NO } },
+#include "../leader.def"
+#undef LEADER_SEQ
+};
+#define SEQ_COUNT (sizeof(seqs) / sizeof(seqs[0]))
+
+typedef struct {
+  uint16_t keycode;       // edge label from the parent
+  char name[MAX_NAME];    // keycode name as written in leader.def
+  int parent;
+  int action;             // index into seqs[], -1 if not a sequence end
+  int index;              // output position, breadth first
+} node_t;
+
+static node_t nodes[MAX_NODES];
+static int node_count = 1;
+static int errors;
+
+static int seq_length(const seq_t *seq) {
+  int n = 0;
+  while (seq->keys[n] != KC_NO && n <= LEADER_MAX_KEYS) {
+    n++;
+  }
+  return n;
+}
+
+// n-th comma separated name from "KC_A, KC_S"
+static void key_name(const seq_t *seq, int n, char *out) {
+  const char *p = seq->names;
+  size_t len;
+  while (n--) {
+    p = strchr(p, ',') + 1;
+  }
+  p += strspn(p, " ");
+  len = strcspn(p, ", ");
+  if (len >= MAX_NAME) {
+    len = MAX_NAME - 1;
+  }
+  memcpy(out, p, len);
+  out[len] = '\0';
+}
+
+static int child(int parent, uint16_t keycode) {
+  int i;
+  for (i = 1; i < node_count; i++) {
+    if (nodes[i].parent == parent && nodes[i].keycode == keycode) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void insert(int s) {
+  const seq_t *seq = &seqs[s];
+  int len = seq_length(seq);
+  int node = 0;
+  int i;
+
+  if (len == 0) {
+    fprintf(stderr, "leader.def: %s has no keys\n", seq->action);
+    errors++;
+    return;
+  }
+  if (len > LEADER_MAX_KEYS) {
+    fprintf(stderr, "leader.def: %s is longer than the %d keys the leader records; "
+                    "only its prefix can ever match\n", seq->action, LEADER_MAX_KEYS);
+    errors++;
+    return;
+  }
+  for (i = 0; i < len; i++) {
+    if (seq->keys[i] == KC_LEAD || seq->keys[i] == KC_TRNS) {
+      fprintf(stderr, "leader.def: %s contains a key the leader never records\n", seq->action);
+      errors++;
+      return;
+    }
+  }
+  for (i = 0; i < len; i++) {
+    int next = child(node, seq->keys[i]);
+    if (next < 0) {
+      if (node_count == MAX_NODES) {
+        fprintf(stderr, "leader.def: more than %d trie nodes\n", MAX_NODES);
+        exit(1);
+      }
+      next = node_count++;
+      nodes[next].keycode = seq->keys[i];
+      key_name(seq, i, nodes[next].name);
+      nodes[next].parent = node;
+      nodes[next].action = -1;
+    }
+    node = next;
+  }
+  if (nodes[node].action >= 0) {
+    fprintf(stderr, "leader.def: %s duplicates %s (%s)\n", seq->action,
+            seqs[nodes[node].action].action, seq->names);
+    errors++;
+    return;
+  }
+  nodes[node].action = s;
+}
+
+static void path(int node, char *out, size_t size) {
+  const char *name;
+  if (node == 0) {
+    snprintf(out, size, "LEAD");
+    return;
+  }
+  path(nodes[node].parent, out, size);
+  name = nodes[node].name;
+  if (strncmp(name, "KC_", 3) == 0) {
+    name += 3;
+  }
+  snprintf(out + strlen(out), size - strlen(out), " %s", name);
+}
+
+int main(void) {
+  int order[MAX_NODES];
+  int edge = 0;
+  int head, tail = 1;
+  size_t s;
+  int i, j;
+
+  nodes[0].parent = -1;
+  nodes[0].action = -1;
+  for (s = 0; s < SEQ_COUNT; s++) {
+    insert(s);
+  }
+  if (errors) {
+    return 1;
+  }
+
+  // Breadth first, so each node's children get consecutive indices and
+  // consecutive edge slots
+  order[0] = 0;
+  for (head = 0; head < tail; head++) {
+    for (j = 1; j < node_count; j++) {
+      if (nodes[j].parent == order[head]) {
+        nodes[j].index = tail;
+        order[tail++] = j;
+      }
+    }
+  }
+
+  printf("// Generated by sim/leader_trie from leader.def; do not edit.\n");
+  printf("// Regenerate with: make -C sim leader_trie\n\n");
+  printf("#define LEADER_TRIE_SEQ_COUNT %zu\n", SEQ_COUNT);
+  printf("#define LEADER_TRIE_DEF_CKSUM %lu\n\n", (unsigned long)def_cksum("../leader.def"));
+  printf("static const leader_node_t PROGMEM leader_nodes[] = {\n");
+  for (i = 0; i < node_count; i++) {
+    int node = order[i];
+    int count = 0;
+    char label[128];
+    for (j = 1; j < node_count; j++) {
+      count += nodes[j].parent == node;
+    }
+    path(node, label, sizeof(label));
+    printf("  { %3d, %d, %-11s }, // %2d: %s%s\n", count ? edge : 0, count,
+           nodes[node].action >= 0 ? seqs[nodes[node].action].action : "LEADER_NONE", i, label,
+           count ? "" : " (prefix-free, runs on its last key)");
+    edge += count;
+  }
+  printf("};\n\n");
+
+  printf("static const leader_edge_t PROGMEM leader_edges[] = {\n");
+  for (i = 1; i < node_count; i++) {
+    int node = order[i];
+    char label[128];
+    char name[MAX_NAME + 1];
+    path(node, label, sizeof(label));
+    snprintf(name, sizeof(name), "%s,", nodes[node].name);
+    printf("  { %-9s %2d }, // %s\n", name, nodes[node].index, label);
+  }
+  printf("};\n");
+  return 0;
+}
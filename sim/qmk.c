@@ -0,0 +1,828 @@
+/* Stub QMK core: just enough of tmk/quantum for keymap.c to run on a host.
+ *
+ * The shape follows the firmware: a tapping stage that holds back LT/MT keys
+ * until they resolve, then process_record_user, the leader capture, space
+ * cadet, and finally the action layer that turns keycodes into reports.
+ */
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
+
+uint32_t sim_now;
+bool sim_verbose;
+sim_stats_t sim_stats;
+uint64_t sim_overhead_ns;
+
+static char log_buf[1 << 16];
+static size_t log_len;
+
+uint64_t sim_clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void sim_timing_add(sim_timing_t *timing, uint64_t ns) {
+  timing->count++;
+  timing->total_ns += ns;
+  if (ns > timing->max_ns) {
+    timing->max_ns = ns;
+  }
+}
+
+static void log_vinsert(size_t at, const char *fmt, va_list ap) {
+  uint64_t start = sim_clock_ns();
+  char line[256];
+  int n = snprintf(line, sizeof(line), "%7u  ", sim_now);
+  n += vsnprintf(line + n, sizeof(line) - n - 1, fmt, ap);
+  if (n > (int)sizeof(line) - 2) {
+    n = sizeof(line) - 2;
+  }
+  line[n++] = '\n';
+  if (log_len + n > sizeof(log_buf)) {
+    sim_flush();
+    at = 0;
+  }
+  memmove(log_buf + at + n, log_buf + at, log_len - at);
+  memcpy(log_buf + at, line, n);
+  log_len += n;
+  sim_overhead_ns += sim_clock_ns() - start;
+}
+
+// Buffered so printing never lands inside a timed hook
+void sim_log(const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  log_vinsert(log_len, fmt, ap);
+  va_end(ap);
+}
+
+size_t sim_log_mark(void) {
+  return log_len;
+}
+
+// Log a line ahead of everything logged since mark, e.g. a record line
+// whose timing is only known after the hook it triggered has run
+void sim_log_at(size_t mark, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  log_vinsert(mark <= log_len ? mark : log_len, fmt, ap);
+  va_end(ap);
+}
+
+void sim_flush(void) {
+  fwrite(log_buf, 1, log_len, stdout);
+  log_len = 0;
+}
+
+void sim_reset_log(void) {
+  log_len = 0;
+}
+
+// "rawhid  <what> 03 00 ..." up to the last byte that isn't 0, past the status
+void sim_raw_hid_log(const char *what, const uint8_t *data, uint8_t length) {
+  char hex[3 * 64 + 1] = "";
+  uint8_t used = length;
+
+  while (used > 2 && !data[used - 1]) {
+    used--;
+  }
+  for (uint8_t i = 0; i < used && i < 64; i++) {
+    snprintf(hex + 3 * i, sizeof(hex) - 3 * i, " %02x", data[i]);
+  }
+  sim_log("rawhid  %s%s", what, hex);
+}
+
+/* Key names for report dumps */
+
+static const char *const basic_names[256] = {
+  [KC_A] = "A", [KC_B] = "B", [KC_C] = "C", [KC_D] = "D", [KC_E] = "E",
+  [KC_F] = "F", [KC_G] = "G", [KC_H] = "H", [KC_I] = "I", [KC_J] = "J",
+  [KC_K] = "K", [KC_L] = "L", [KC_M] = "M", [KC_N] = "N", [KC_O] = "O",
+  [KC_P] = "P", [KC_Q] = "Q", [KC_R] = "R", [KC_S] = "S", [KC_T] = "T",
+  [KC_U] = "U", [KC_V] = "V", [KC_W] = "W", [KC_X] = "X", [KC_Y] = "Y",
+  [KC_Z] = "Z",
+  [KC_1] = "1", [KC_2] = "2", [KC_3] = "3", [KC_4] = "4", [KC_5] = "5",
+  [KC_6] = "6", [KC_7] = "7", [KC_8] = "8", [KC_9] = "9", [KC_0] = "0",
+  [KC_ENTER] = "ENT", [KC_ESCAPE] = "ESC", [KC_BSPACE] = "BSPC",
+  [KC_TAB] = "TAB", [KC_SPACE] = "SPC", [KC_MINUS] = "MINS",
+  [KC_EQUAL] = "EQL", [KC_LBRACKET] = "LBRC", [KC_RBRACKET] = "RBRC",
+  [KC_BSLASH] = "BSLS", [KC_SCOLON] = "SCLN", [KC_QUOTE] = "QUOT",
+  [KC_GRAVE] = "GRV", [KC_COMMA] = "COMM", [KC_DOT] = "DOT",
+  [KC_SLASH] = "SLSH", [KC_CAPSLOCK] = "CAPS",
+  [KC_F1] = "F1", [KC_F2] = "F2", [KC_F3] = "F3", [KC_F4] = "F4",
+  [KC_F5] = "F5", [KC_F6] = "F6", [KC_F7] = "F7", [KC_F8] = "F8",
+  [KC_F9] = "F9", [KC_F10] = "F10", [KC_F11] = "F11", [KC_F12] = "F12",
+  [KC_HOME] = "HOME", [KC_PGUP] = "PGUP", [KC_DELETE] = "DEL",
+  [KC_END] = "END", [KC_PGDOWN] = "PGDN", [KC_RIGHT] = "RGHT",
+  [KC_LEFT] = "LEFT", [KC_DOWN] = "DOWN", [KC_UP] = "UP",
+  [KC_AUDIO_MUTE] = "MUTE", [KC_AUDIO_VOL_UP] = "VOLU",
+  [KC_AUDIO_VOL_DOWN] = "VOLD", [KC_MEDIA_NEXT_TRACK] = "MNXT",
+  [KC_MEDIA_PREV_TRACK] = "MPRV", [KC_MEDIA_PLAY_PAUSE] = "MPLY",
+  [KC_WWW_BACK] = "WBAK", [KC_WWW_FORWARD] = "WFWD",
+  [KC_LCTRL] = "LCTL", [KC_LSHIFT] = "LSFT", [KC_LALT] = "LALT",
+  [KC_LGUI] = "LGUI", [KC_RCTRL] = "RCTL", [KC_RSHIFT] = "RSFT",
+  [KC_RALT] = "RALT", [KC_RGUI] = "RGUI",
+  [KC_MS_UP] = "MS_U", [KC_MS_DOWN] = "MS_D", [KC_MS_LEFT] = "MS_L",
+  [KC_MS_RIGHT] = "MS_R", [KC_MS_BTN1] = "BTN1", [KC_MS_BTN2] = "BTN2",
+  [KC_MS_BTN3] = "BTN3"
+};
+
+static const char *key_name(uint8_t code) {
+  static char hex[2][8];
+  static uint8_t slot;
+  if (basic_names[code]) {
+    return basic_names[code];
+  }
+  slot ^= 1;
+  snprintf(hex[slot], sizeof(hex[slot]), "0x%02X", code);
+  return hex[slot];
+}
+
+/* Timer */
+
+uint16_t timer_read(void) { return (uint16_t)sim_now; }
+uint32_t timer_read32(void) { return sim_now; }
+uint16_t timer_elapsed(uint16_t last) { return (uint16_t)(sim_now - last); }
+uint32_t timer_elapsed32(uint32_t last) { return sim_now - last; }
+
+void wait_ms(uint16_t ms) {
+  sim_now += ms;
+  sim_stats.blocked_ms += ms;
+}
+
+void eeconfig_init(void) {
+  sim_log("eeconfig  init");
+}
+
+/* EEPROM, 1 KiB like the ATmega32U4's; erased cells read 0xFF */
+
+uint8_t sim_eeprom[SIM_EEPROM_SIZE];
+
+static size_t eeprom_offset(const void *addr, size_t len) {
+  size_t offset = (size_t)addr;
+  if (offset + len > SIM_EEPROM_SIZE) {
+    fprintf(stderr, "eeprom access %zu+%zu past %d bytes\n", offset, len, SIM_EEPROM_SIZE);
+    exit(1);
+  }
+  return offset;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+  return sim_eeprom[eeprom_offset(addr, 1)];
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value) {
+  eeprom_update_block(&value, addr, 1);
+}
+
+void eeprom_read_block(void *buf, const void *addr, size_t len) {
+  memcpy(buf, &sim_eeprom[eeprom_offset(addr, len)], len);
+}
+
+// Like avr-libc, only cells whose value changes are written
+void eeprom_update_block(const void *buf, void *addr, size_t len) {
+  size_t offset = eeprom_offset(addr, len);
+  const uint8_t *src = buf;
+  unsigned written = 0;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    if (sim_eeprom[offset + i] != src[i]) {
+      sim_eeprom[offset + i] = src[i];
+      written++;
+    }
+  }
+  if (written) {
+    sim_stats.eeprom_writes += written;
+    sim_log("eeprom  %u of %zu bytes written at %zu", written, len, offset);
+  }
+}
+
+/* Keyboard report */
+
+static uint8_t real_mods;
+static report_keyboard_t report;
+report_keyboard_t *keyboard_report = &report;
+static uint8_t sent_keys[6];
+
+char sim_typed[SIM_TYPED_SIZE];
+static size_t typed_len;
+
+// What a US layout host would type for the keys new in this report. Only
+// plain and shifted keys count; chords with Ctrl, Alt or GUI type nothing.
+static void track_typed(void) {
+  bool shift = real_mods & (MOD_BIT(KC_LSFT) | MOD_BIT(KC_RSFT));
+  uint8_t i, j, ascii;
+
+  for (i = 0; i < 6; i++) {
+    uint8_t key = keyboard_report->keys[i];
+    bool held = false;
+    if (!key) {
+      continue;
+    }
+    for (j = 0; j < 6; j++) {
+      held |= sent_keys[j] == key;
+    }
+    if (held || (real_mods & ~(MOD_BIT(KC_LSFT) | MOD_BIT(KC_RSFT)))) {
+      continue;
+    }
+    for (ascii = 1; ascii < 0x80; ascii++) {
+      if (ascii_to_keycode_lut[ascii] == key && ascii_to_shift_lut[ascii] == shift) {
+        if (typed_len < SIM_TYPED_SIZE - 1) {
+          sim_typed[typed_len++] = ascii;
+        }
+        break;
+      }
+    }
+  }
+  memcpy(sent_keys, keyboard_report->keys, sizeof(sent_keys));
+}
+
+void send_keyboard_report(void) {
+  uint64_t overhead = sim_overhead_ns;
+  uint64_t start = sim_clock_ns();
+  char line[128];
+  size_t len = 0;
+  uint8_t i;
+
+  keyboard_report->mods = real_mods;
+  sim_stats.reports++;
+  track_typed();
+  for (i = 0; i < 8; i++) {
+    if (real_mods & (1 << i)) {
+      len += snprintf(line + len, sizeof(line) - len, "%s%s", len ? "+" : "", key_name(KC_LCTRL + i));
+    }
+  }
+  len += snprintf(line + len, sizeof(line) - len, "%s[", len ? " " : "");
+  for (i = 0; i < 6; i++) {
+    if (keyboard_report->keys[i]) {
+      len += snprintf(line + len, sizeof(line) - len, " %s", key_name(keyboard_report->keys[i]));
+    }
+  }
+  snprintf(line + len, sizeof(line) - len, " ]");
+  sim_log("report  %s", line);
+  sim_overhead_ns = overhead + (sim_clock_ns() - start);
+}
+
+void host_mouse_send(report_mouse_t *report) {
+  uint64_t overhead = sim_overhead_ns;
+  uint64_t start = sim_clock_ns();
+
+  sim_stats.mouse_reports++;
+  sim_stats.mouse_x += report->x;
+  sim_stats.mouse_y += report->y;
+  sim_log("mouse   buttons=%02x x=%d y=%d v=%d h=%d", report->buttons, report->x, report->y,
+          report->v, report->h);
+  sim_overhead_ns = overhead + (sim_clock_ns() - start);
+}
+
+void raw_hid_send(uint8_t *data, uint8_t length) {
+  uint64_t overhead = sim_overhead_ns;
+  uint64_t start = sim_clock_ns();
+
+  sim_raw_hid_log("sent", data, length);
+  sim_overhead_ns = overhead + (sim_clock_ns() - start);
+}
+
+uint8_t get_mods(void) { return real_mods; }
+void add_mods(uint8_t mods) { real_mods |= mods; }
+void del_mods(uint8_t mods) { real_mods &= ~mods; }
+void set_mods(uint8_t mods) { real_mods = mods; }
+void clear_mods(void) { real_mods = 0; }
+
+void add_key(uint8_t key) {
+  uint8_t i;
+  for (i = 0; i < 6; i++) {
+    if (keyboard_report->keys[i] == key) {
+      return;
+    }
+  }
+  for (i = 0; i < 6; i++) {
+    if (!keyboard_report->keys[i]) {
+      keyboard_report->keys[i] = key;
+      return;
+    }
+  }
+}
+
+void del_key(uint8_t key) {
+  uint8_t i;
+  for (i = 0; i < 6; i++) {
+    if (keyboard_report->keys[i] == key) {
+      keyboard_report->keys[i] = 0;
+    }
+  }
+}
+
+void clear_keys(void) {
+  memset(keyboard_report->keys, 0, sizeof(keyboard_report->keys));
+}
+
+void register_code(uint8_t code) {
+  if (code == KC_NO) {
+    return;
+  }
+  if (IS_MOD(code)) {
+    add_mods(MOD_BIT(code));
+  } else if (IS_CONSUMER(code)) {
+    sim_log("consumer %s down", key_name(code));
+    return;
+  } else if (IS_MOUSEKEY(code)) {
+    sim_log("mouse   %s down", key_name(code));
+    return;
+  } else {
+    add_key(code);
+  }
+  send_keyboard_report();
+}
+
+void unregister_code(uint8_t code) {
+  if (code == KC_NO) {
+    return;
+  }
+  if (IS_MOD(code)) {
+    del_mods(MOD_BIT(code));
+  } else if (IS_CONSUMER(code)) {
+    sim_log("consumer %s up", key_name(code));
+    return;
+  } else if (IS_MOUSEKEY(code)) {
+    sim_log("mouse   %s up", key_name(code));
+    return;
+  } else {
+    del_key(code);
+  }
+  send_keyboard_report();
+}
+
+void register_mods(uint8_t mods) {
+  if (mods) {
+    add_mods(mods);
+    send_keyboard_report();
+  }
+}
+
+void unregister_mods(uint8_t mods) {
+  if (mods) {
+    del_mods(mods);
+    send_keyboard_report();
+  }
+}
+
+void clear_keyboard(void) {
+  clear_mods();
+  clear_keys();
+  send_keyboard_report();
+}
+
+/* Host */
+
+uint8_t host_leds;
+
+uint8_t host_keyboard_leds(void) { return host_leds; }
+
+/* Layers */
+
+uint32_t layer_state;
+uint32_t default_layer_state = 1;
+
+static void layer_state_changed(uint32_t state) {
+  if (state != layer_state) {
+    sim_log("layer   0x%04X -> 0x%04X", layer_state, state);
+  }
+  layer_state = state;
+}
+
+void layer_state_set(uint32_t state) { layer_state_changed(state); }
+void layer_clear(void) { layer_state_changed(0); }
+void layer_move(uint8_t layer) { layer_state_changed(1UL << layer); }
+void layer_on(uint8_t layer) { layer_state_changed(layer_state | (1UL << layer)); }
+void layer_off(uint8_t layer) { layer_state_changed(layer_state & ~(1UL << layer)); }
+void layer_invert(uint8_t layer) { layer_state_changed(layer_state ^ (1UL << layer)); }
+
+uint8_t biton32(uint32_t bits) {
+  uint8_t n = 0;
+  while (bits >>= 1) {
+    n++;
+  }
+  return n;
+}
+
+__attribute__((weak)) uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+  return pgm_read_word(&keymaps[layer][key.row][key.col]);
+}
+
+// action.c's layer_switch_get_layer(): the top active layer that isn't
+// transparent at key, BASE if none is
+static uint8_t keymap_source_layer(keypos_t key) {
+  uint32_t layers = layer_state | default_layer_state;
+  int8_t i;
+  for (i = 31; i >= 0; i--) {
+    if ((layers & (1UL << i)) && i < sim_keymap_layers) {
+      if (keymap_key_to_keycode(i, key) != KC_TRNS) {
+        return i;
+      }
+    }
+  }
+  return 0;
+}
+
+/* LEDs; only state changes are logged */
+
+static uint8_t led_level[4]; // board, right 1..3
+
+static void led_set(uint8_t led, uint8_t level) {
+  uint8_t was = led_level[led];
+  sim_stats.led_calls++;
+  led_level[led] = level;
+  if ((!was != !level) || (sim_verbose && was != level)) {
+    sim_log("led     board=%u r1=%u r2=%u r3=%u", led_level[0], led_level[1], led_level[2], led_level[3]);
+  }
+}
+
+void ergodox_board_led_on(void) { led_set(0, LED_BRIGHTNESS_HI); }
+void ergodox_board_led_off(void) { led_set(0, 0); }
+void ergodox_right_led_1_on(void) { led_set(1, LED_BRIGHTNESS_HI); }
+void ergodox_right_led_1_off(void) { led_set(1, 0); }
+void ergodox_right_led_2_on(void) { led_set(2, LED_BRIGHTNESS_HI); }
+void ergodox_right_led_2_off(void) { led_set(2, 0); }
+void ergodox_right_led_3_on(void) { led_set(3, LED_BRIGHTNESS_HI); }
+void ergodox_right_led_3_off(void) { led_set(3, 0); }
+void ergodox_right_led_on(uint8_t led) { led_set(led, LED_BRIGHTNESS_HI); }
+void ergodox_right_led_off(uint8_t led) { led_set(led, 0); }
+void ergodox_right_led_1_set(uint8_t n) { led_set(1, n); }
+void ergodox_right_led_2_set(uint8_t n) { led_set(2, n); }
+void ergodox_right_led_3_set(uint8_t n) { led_set(3, n); }
+void ergodox_right_led_set(uint8_t led, uint8_t n) { led_set(led, n); }
+
+void ergodox_led_all_on(void) {
+  ergodox_board_led_on();
+  ergodox_right_led_1_on();
+  ergodox_right_led_2_on();
+  ergodox_right_led_3_on();
+}
+
+void ergodox_led_all_off(void) {
+  ergodox_board_led_off();
+  ergodox_right_led_1_off();
+  ergodox_right_led_2_off();
+  ergodox_right_led_3_off();
+}
+
+void ergodox_led_all_set(uint8_t n) {
+  ergodox_right_led_1_set(n);
+  ergodox_right_led_2_set(n);
+  ergodox_right_led_3_set(n);
+}
+
+/* Macros and strings */
+
+void action_macro_play(const macro_t *macro_p) {
+  uint8_t interval = 0;
+  macro_t code;
+
+  if (!macro_p) {
+    return;
+  }
+  while ((code = pgm_read_byte(macro_p++)) != END) {
+    switch (code) {
+      case KEY_DOWN:
+        register_code(pgm_read_byte(macro_p++));
+        break;
+      case KEY_UP:
+        unregister_code(pgm_read_byte(macro_p++));
+        break;
+      case WAIT:
+        wait_ms(pgm_read_byte(macro_p++));
+        break;
+      case INTERVAL:
+        interval = pgm_read_byte(macro_p++);
+        break;
+      default:
+        return;
+    }
+    if (interval) {
+      wait_ms(interval);
+    }
+  }
+}
+
+__attribute__((weak))
+const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt) {
+  return MACRO_NONE;
+}
+
+// quantum.c's tables, indexed by 7-bit ASCII
+const bool ascii_to_shift_lut[0x80] PROGMEM = {
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 1, 1, 1, 1, 1, 1, 0,
+  1, 1, 1, 1, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 1, 0, 1, 0, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 0, 0, 0, 1, 1,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 1, 1, 1, 1, 0,
+};
+
+const uint8_t ascii_to_keycode_lut[0x80] PROGMEM = {
+  0,       0,       0,       0,       0,       0,       0,       0,
+  KC_BSPC, KC_TAB,  KC_ENT,  0,       0,       0,       0,       0,
+  0,       0,       0,       0,       0,       0,       0,       0,
+  0,       0,       0,       KC_ESC,  0,       0,       0,       0,
+  KC_SPC,  KC_1,    KC_QUOT, KC_3,    KC_4,    KC_5,    KC_7,    KC_QUOT,
+  KC_9,    KC_0,    KC_8,    KC_EQL,  KC_COMM, KC_MINS, KC_DOT,  KC_SLSH,
+  KC_0,    KC_1,    KC_2,    KC_3,    KC_4,    KC_5,    KC_6,    KC_7,
+  KC_8,    KC_9,    KC_SCLN, KC_SCLN, KC_COMM, KC_EQL,  KC_DOT,  KC_SLSH,
+  KC_2,    KC_A,    KC_B,    KC_C,    KC_D,    KC_E,    KC_F,    KC_G,
+  KC_H,    KC_I,    KC_J,    KC_K,    KC_L,    KC_M,    KC_N,    KC_O,
+  KC_P,    KC_Q,    KC_R,    KC_S,    KC_T,    KC_U,    KC_V,    KC_W,
+  KC_X,    KC_Y,    KC_Z,    KC_LBRC, KC_BSLS, KC_RBRC, KC_6,    KC_MINS,
+  KC_GRV,  KC_A,    KC_B,    KC_C,    KC_D,    KC_E,    KC_F,    KC_G,
+  KC_H,    KC_I,    KC_J,    KC_K,    KC_L,    KC_M,    KC_N,    KC_O,
+  KC_P,    KC_Q,    KC_R,    KC_S,    KC_T,    KC_U,    KC_V,    KC_W,
+  KC_X,    KC_Y,    KC_Z,    KC_LBRC, KC_BSLS, KC_RBRC, KC_GRV,  0,
+};
+
+void send_string(const char *str) {
+  uint8_t ascii;
+  while ((ascii = pgm_read_byte(str++))) {
+    uint8_t keycode = pgm_read_byte(&ascii_to_keycode_lut[ascii & 0x7F]);
+    bool shift = pgm_read_byte(&ascii_to_shift_lut[ascii & 0x7F]);
+    if (shift) {
+      register_code(KC_LSFT);
+    }
+    register_code(keycode);
+    unregister_code(keycode);
+    if (shift) {
+      unregister_code(KC_LSFT);
+    }
+  }
+}
+
+/* Leader (process_leader.c) */
+
+bool leading;
+uint16_t leader_time;
+uint16_t leader_sequence[5];
+uint8_t leader_sequence_size;
+
+__attribute__((weak)) void leader_start(void) {}
+__attribute__((weak)) void leader_end(void) {}
+
+static bool process_leader(uint16_t keycode, keyrecord_t *record) {
+  if (record->event.pressed) {
+    if (!leading && keycode == KC_LEAD) {
+      leader_start();
+      leading = true;
+      leader_time = timer_read();
+      leader_sequence_size = 0;
+      memset(leader_sequence, 0, sizeof(leader_sequence));
+      return false;
+    }
+    if (leading && timer_elapsed(leader_time) < LEADER_TIMEOUT) {
+      if (leader_sequence_size < 5) {
+        leader_sequence[leader_sequence_size++] = keycode;
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Space cadet shift (quantum.c) */
+
+static uint16_t spc_timer[2];
+static bool shift_interrupted[2];
+
+static bool process_space_cadet(uint16_t keycode, keyrecord_t *record) {
+  uint8_t side = keycode == KC_RSPC;
+  if (keycode != KC_LSPO && keycode != KC_RSPC) {
+    shift_interrupted[0] = shift_interrupted[1] = true;
+    return true;
+  }
+  if (record->event.pressed) {
+    shift_interrupted[side] = false;
+    spc_timer[side] = timer_read();
+    register_mods(MOD_BIT(side ? KC_RSFT : KC_LSFT));
+  } else {
+    if (!shift_interrupted[side] && timer_elapsed(spc_timer[side]) < TAPPING_TERM) {
+      register_code(side ? KC_0 : KC_9);
+      unregister_code(side ? KC_0 : KC_9);
+    }
+    unregister_mods(MOD_BIT(side ? KC_RSFT : KC_LSFT));
+  }
+  return false;
+}
+
+/* Action layer */
+
+static uint8_t oneshot_layer;
+static uint8_t oneshot_state; // oneshot_fullfillment_t bits still pending
+
+uint8_t get_oneshot_layer(void) {
+  return oneshot_layer;
+}
+
+uint8_t get_oneshot_layer_state(void) {
+  return oneshot_state;
+}
+
+void clear_oneshot_layer_state(oneshot_fullfillment_t state) {
+  uint8_t start = oneshot_state;
+
+  oneshot_state &= ~state;
+  if (start && !oneshot_state) {
+    layer_off(oneshot_layer);
+    oneshot_layer = 0;
+  }
+}
+
+// Five-bit mod encoding of MT()/LCTL() etc. to a report mod byte
+static uint8_t mods_to_bits(uint8_t mods) {
+  return (mods & 0x10) ? (mods & 0x0F) << 4 : mods & 0x0F;
+}
+
+static void process_action(uint16_t keycode, keyrecord_t *record) {
+  bool pressed = record->event.pressed;
+
+  if (keycode <= QK_TMK_MAX) {
+    if (pressed) {
+      register_code(keycode);
+    } else {
+      unregister_code(keycode);
+    }
+  } else if (keycode <= QK_MODS_MAX) {
+    uint8_t mods = mods_to_bits(keycode >> 8);
+    if (pressed) {
+      register_mods(mods);
+      register_code(keycode & 0xFF);
+    } else {
+      unregister_code(keycode & 0xFF);
+      unregister_mods(mods);
+    }
+  } else if (keycode >= QK_LAYER_TAP && keycode <= QK_LAYER_TAP_MAX) {
+    uint8_t layer = (keycode >> 8) & 0xF;
+    if (record->tap.count) {
+      process_action(keycode & 0xFF, record);
+    } else if (pressed) {
+      layer_on(layer);
+    } else {
+      layer_off(layer);
+    }
+  } else if (keycode >= QK_MOD_TAP && keycode <= QK_MOD_TAP_MAX) {
+    uint8_t mods = mods_to_bits((keycode >> 8) & 0x1F);
+    if (record->tap.count) {
+      process_action(keycode & 0xFF, record);
+    } else if (pressed) {
+      register_mods(mods);
+    } else {
+      unregister_mods(mods);
+    }
+  } else if (keycode >= QK_MOMENTARY && keycode <= QK_MOMENTARY_MAX) {
+    if (pressed) {
+      layer_on(keycode & 0xFF);
+    } else {
+      layer_off(keycode & 0xFF);
+    }
+  } else if (keycode >= QK_TOGGLE_LAYER && keycode <= QK_TOGGLE_LAYER_MAX) {
+    if (pressed) {
+      layer_invert(keycode & 0xFF);
+    }
+  } else if (keycode >= QK_TO && keycode <= QK_TO_MAX) {
+    if (pressed) {
+      layer_move(keycode & 0xFF);
+    }
+  } else if (keycode >= QK_ONE_SHOT_LAYER && keycode <= QK_ONE_SHOT_LAYER_MAX) {
+    if (pressed) {
+      oneshot_layer = keycode & 0xFF;
+      oneshot_state = ONESHOT_START;
+      layer_on(oneshot_layer);
+    } else {
+      clear_oneshot_layer_state(ONESHOT_PRESSED);
+    }
+  } else if (keycode >= QK_MACRO && keycode <= QK_MACRO_MAX) {
+    action_macro_play(action_get_macro(record, keycode & 0xFF, 0));
+  } else if (pressed && keycode < SAFE_RANGE) {
+    sim_log("unhandled 0x%04X", keycode);
+  }
+}
+
+// As QMK keeps them (PREVENT_STUCK_MODIFIERS): the layer a key was pressed
+// on, where its release is looked up again whatever the layers are by then
+static uint8_t source_layer[MATRIX_ROWS][MATRIX_COLS];
+
+static void process_record(keyrecord_t *record) {
+  keypos_t key = record->event.key;
+  uint16_t keycode;
+  uint64_t start;
+  size_t mark;
+  bool handled;
+
+  if (record->event.pressed) {
+    source_layer[key.row][key.col] = keymap_source_layer(key);
+  }
+  keycode = keymap_key_to_keycode(source_layer[key.row][key.col], key);
+
+  sim_record_seen(record, keycode);
+  mark = sim_log_mark();
+  sim_overhead_ns = 0;
+  start = sim_clock_ns();
+  handled = !process_record_user(keycode, record);
+  start = sim_clock_ns() - start - sim_overhead_ns;
+  sim_timing_add(&sim_stats.record, start);
+  sim_log_at(mark, "%-7s [%2u,%u] kc=0x%04X%s  user=%lluns",
+             record->event.pressed ? "press" : "release", key.row, key.col, keycode,
+             record->tap.count ? " tap" : "", (unsigned long long)start);
+
+  if (handled || !process_leader(keycode, record) || !process_space_cadet(keycode, record)) {
+    return;
+  }
+  process_action(keycode, record);
+
+  if (oneshot_state && !(oneshot_state & ONESHOT_PRESSED) && record->event.pressed &&
+      !(keycode >= QK_ONE_SHOT_LAYER && keycode <= QK_ONE_SHOT_LAYER_MAX)) {
+    clear_oneshot_layer_state(ONESHOT_OTHER_KEY_PRESSED);
+  }
+}
+
+/* Tapping (action_tapping.c): LT/MT keys wait until released or past TAPPING_TERM */
+
+#define WAITING_BUFFER_SIZE 8
+
+static keyrecord_t tapping_key;
+static bool tapping_active;
+static keyrecord_t waiting_buffer[WAITING_BUFFER_SIZE];
+static uint8_t waiting_count;
+
+static bool is_tap_keycode(uint16_t keycode) {
+  return (keycode >= QK_LAYER_TAP && keycode <= QK_LAYER_TAP_MAX) ||
+         (keycode >= QK_MOD_TAP && keycode <= QK_MOD_TAP_MAX);
+}
+
+static void tapping_process(keyrecord_t record);
+
+static void waiting_buffer_replay(void) {
+  keyrecord_t replay[WAITING_BUFFER_SIZE];
+  uint8_t count = waiting_count;
+  uint8_t i;
+
+  memcpy(replay, waiting_buffer, sizeof(replay));
+  waiting_count = 0;
+  for (i = 0; i < count; i++) {
+    tapping_process(replay[i]);
+  }
+}
+
+static void tapping_process(keyrecord_t record) {
+  keypos_t key = record.event.key;
+
+  if (tapping_active) {
+    keypos_t held = tapping_key.event.key;
+    if (!record.event.pressed && key.row == held.row && key.col == held.col) {
+      tapping_active = false;
+      tapping_key.tap.count = 1;
+      process_record(&tapping_key);
+      record.tap.count = 1;
+      process_record(&record);
+      waiting_buffer_replay();
+    } else if (waiting_count < WAITING_BUFFER_SIZE) {
+      waiting_buffer[waiting_count++] = record;
+    }
+    return;
+  }
+  if (record.event.pressed && is_tap_keycode(keymap_key_to_keycode(keymap_source_layer(key), key))) {
+    tapping_key = record;
+    tapping_active = true;
+    return;
+  }
+  process_record(&record);
+}
+
+void sim_key_event(uint8_t row, uint8_t col, bool pressed, uint32_t time) {
+  keyrecord_t record = {
+    .event = { .key = { .col = col, .row = row }, .pressed = pressed, .time = (uint16_t)time }
+  };
+  tapping_process(record);
+}
+
+void sim_tick(void) {
+  if (tapping_active && timer_elapsed(tapping_key.event.time) >= TAPPING_TERM) {
+    tapping_active = false;
+    tapping_key.tap.count = 0;
+    process_record(&tapping_key);
+    waiting_buffer_replay();
+  }
+}
@@ -0,0 +1,6 @@
+#ifndef SIM_ACTION_LAYER_H
+#define SIM_ACTION_LAYER_H
+
+#include "qmk.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SIM_ACTION_MACRO_H
+#define SIM_ACTION_MACRO_H
+
+#include "qmk.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include "qmk.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SIM_ERGODOX_H
+#define SIM_ERGODOX_H
+
+#include "qmk.h"
+
+#endif
@@ -0,0 +1,560 @@
+/* Host stand-ins for the parts of the QMK core that keymap.c touches.
+ *
+ * Keycode values follow QMK's keycode.h / quantum_keycodes.h so traces and
+ * report dumps line up with what the firmware sends. Only what the keymap
+ * uses is declared here; add to it when the keymap grows.
+ */
+#ifndef SIM_QMK_H
+#define SIM_QMK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Ergodox EZ matrix
+#define MATRIX_ROWS 14
+#define MATRIX_COLS 6
+
+#ifndef TAPPING_TERM
+  #define TAPPING_TERM 200
+#endif
+#ifndef LEADER_TIMEOUT
+  #define LEADER_TIMEOUT 300
+#endif
+
+// avr/pgmspace.h
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+
+// version.h
+#define QMK_KEYBOARD "ergodox"
+#define QMK_KEYMAP "ambi-macs"
+#define QMK_VERSION "sim"
+
+// Basic (HID usage) keycodes
+enum hid_keyboard_keypad_usage {
+  KC_NO = 0x00,
+  KC_ROLL_OVER,
+  KC_POST_FAIL,
+  KC_UNDEFINED,
+  KC_A, KC_B, KC_C, KC_D, KC_E, KC_F, KC_G, KC_H, KC_I, KC_J, KC_K, KC_L, KC_M,
+  KC_N, KC_O, KC_P, KC_Q, KC_R, KC_S, KC_T, KC_U, KC_V, KC_W, KC_X, KC_Y, KC_Z,
+  KC_1, KC_2, KC_3, KC_4, KC_5, KC_6, KC_7, KC_8, KC_9, KC_0,
+  KC_ENTER,     // 0x28
+  KC_ESCAPE,
+  KC_BSPACE,
+  KC_TAB,
+  KC_SPACE,
+  KC_MINUS,
+  KC_EQUAL,
+  KC_LBRACKET,
+  KC_RBRACKET,
+  KC_BSLASH,
+  KC_NONUS_HASH,
+  KC_SCOLON,
+  KC_QUOTE,
+  KC_GRAVE,
+  KC_COMMA,
+  KC_DOT,
+  KC_SLASH,
+  KC_CAPSLOCK,
+  KC_F1, KC_F2, KC_F3, KC_F4, KC_F5, KC_F6,
+  KC_F7, KC_F8, KC_F9, KC_F10, KC_F11, KC_F12,
+  KC_PSCREEN,   // 0x46
+  KC_SCROLLLOCK,
+  KC_PAUSE,
+  KC_INSERT,
+  KC_HOME,
+  KC_PGUP,
+  KC_DELETE,
+  KC_END,
+  KC_PGDOWN,
+  KC_RIGHT,
+  KC_LEFT,
+  KC_DOWN,
+  KC_UP,        // 0x52
+  KC_EXSEL = 0xA4, // last keyboard page code; the stub names only the ones above
+
+  // System & consumer
+  KC_SYSTEM_POWER = 0xA5,
+  KC_SYSTEM_SLEEP,
+  KC_SYSTEM_WAKE,
+  KC_AUDIO_MUTE,
+  KC_AUDIO_VOL_UP,
+  KC_AUDIO_VOL_DOWN,
+  KC_MEDIA_NEXT_TRACK,
+  KC_MEDIA_PREV_TRACK,
+  KC_MEDIA_STOP,
+  KC_MEDIA_PLAY_PAUSE,
+  KC_MEDIA_SELECT,
+  KC_MEDIA_EJECT,
+  KC_MAIL,
+  KC_CALCULATOR,
+  KC_MY_COMPUTER,
+  KC_WWW_SEARCH,
+  KC_WWW_HOME,
+  KC_WWW_BACK,
+  KC_WWW_FORWARD,
+  KC_WWW_STOP,
+  KC_WWW_REFRESH,
+  KC_WWW_FAVORITES, // 0xBA
+
+  // Modifiers
+  KC_LCTRL = 0xE0,
+  KC_LSHIFT,
+  KC_LALT,
+  KC_LGUI,
+  KC_RCTRL,
+  KC_RSHIFT,
+  KC_RALT,
+  KC_RGUI,
+
+  // Mousekey
+  KC_MS_UP = 0xF0,
+  KC_MS_DOWN,
+  KC_MS_LEFT,
+  KC_MS_RIGHT,
+  KC_MS_BTN1,
+  KC_MS_BTN2,
+  KC_MS_BTN3,
+  KC_MS_BTN4,
+  KC_MS_BTN5,
+  KC_MS_WH_UP,
+  KC_MS_WH_DOWN,
+  KC_MS_WH_LEFT,
+  KC_MS_WH_RIGHT,
+  KC_MS_ACCEL0,
+  KC_MS_ACCEL1,
+  KC_MS_ACCEL2
+};
+
+#define KC_TRANSPARENT 0x01
+#define KC_TRNS KC_TRANSPARENT
+
+#define IS_KEY(code) (KC_A <= (code) && (code) <= KC_EXSEL)
+#define IS_MOD(code) (KC_LCTRL <= (code) && (code) <= KC_RGUI)
+#define IS_CONSUMER(code) (KC_SYSTEM_POWER <= (code) && (code) <= KC_WWW_FAVORITES)
+#define IS_MOUSEKEY(code) (KC_MS_UP <= (code) && (code) <= KC_MS_ACCEL2)
+
+#define KC_ENT KC_ENTER
+#define KC_ESC KC_ESCAPE
+#define KC_BSPC KC_BSPACE
+#define KC_SPC KC_SPACE
+#define KC_MINS KC_MINUS
+#define KC_EQL KC_EQUAL
+#define KC_LBRC KC_LBRACKET
+#define KC_RBRC KC_RBRACKET
+#define KC_BSLS KC_BSLASH
+#define KC_SCLN KC_SCOLON
+#define KC_QUOT KC_QUOTE
+#define KC_GRV KC_GRAVE
+#define KC_COMM KC_COMMA
+#define KC_SLSH KC_SLASH
+#define KC_CAPS KC_CAPSLOCK
+#define KC_PSCR KC_PSCREEN
+#define KC_INS KC_INSERT
+#define KC_DEL KC_DELETE
+#define KC_DELT KC_DELETE
+#define KC_PGDN KC_PGDOWN
+#define KC_RGHT KC_RIGHT
+#define KC_LCTL KC_LCTRL
+#define KC_LSFT KC_LSHIFT
+#define KC_RCTL KC_RCTRL
+#define KC_RSFT KC_RSHIFT
+#define KC_LCMD KC_LGUI
+#define KC_RCMD KC_RGUI
+#define KC_MUTE KC_AUDIO_MUTE
+#define KC_VOLU KC_AUDIO_VOL_UP
+#define KC_VOLD KC_AUDIO_VOL_DOWN
+#define KC_MNXT KC_MEDIA_NEXT_TRACK
+#define KC_MPRV KC_MEDIA_PREV_TRACK
+#define KC_MSTP KC_MEDIA_STOP
+#define KC_MPLY KC_MEDIA_PLAY_PAUSE
+#define KC_WBAK KC_WWW_BACK
+#define KC_WFWD KC_WWW_FORWARD
+#define KC_MS_U KC_MS_UP
+#define KC_MS_D KC_MS_DOWN
+#define KC_MS_L KC_MS_LEFT
+#define KC_MS_R KC_MS_RIGHT
+#define KC_BTN1 KC_MS_BTN1
+#define KC_BTN2 KC_MS_BTN2
+#define KC_BTN3 KC_MS_BTN3
+#define KC_BTN4 KC_MS_BTN4
+#define KC_BTN5 KC_MS_BTN5
+#define KC_WH_U KC_MS_WH_UP
+#define KC_WH_D KC_MS_WH_DOWN
+#define KC_WH_L KC_MS_WH_LEFT
+#define KC_WH_R KC_MS_WH_RIGHT
+#define KC_ACL0 KC_MS_ACCEL0
+#define KC_ACL1 KC_MS_ACCEL1
+#define KC_ACL2 KC_MS_ACCEL2
+
+// Modifier bits
+#define MOD_BIT(code) (1 << ((code) & 0x07))
+#define MOD_LCTL 0x01
+#define MOD_LSFT 0x02
+#define MOD_LALT 0x04
+#define MOD_LGUI 0x08
+#define MOD_RCTL 0x11
+#define MOD_RSFT 0x12
+#define MOD_RALT 0x14
+#define MOD_RGUI 0x18
+#define MOD_HYPR 0x0F
+#define MOD_MEH 0x07
+
+// Quantum keycode ranges
+enum quantum_keycodes {
+  QK_TMK                = 0x0000,
+  QK_TMK_MAX            = 0x00FF,
+  QK_MODS               = 0x0100,
+  QK_LCTL               = 0x0100,
+  QK_LSFT               = 0x0200,
+  QK_LALT               = 0x0400,
+  QK_LGUI               = 0x0800,
+  QK_RMODS_MIN          = 0x1000,
+  QK_RCTL               = 0x1100,
+  QK_RSFT               = 0x1200,
+  QK_RALT               = 0x1400,
+  QK_RGUI               = 0x1800,
+  QK_MODS_MAX           = 0x1FFF,
+  QK_FUNCTION           = 0x2000,
+  QK_FUNCTION_MAX       = 0x2FFF,
+  QK_MACRO              = 0x3000,
+  QK_MACRO_MAX          = 0x3FFF,
+  QK_LAYER_TAP          = 0x4000,
+  QK_LAYER_TAP_MAX      = 0x4FFF,
+  QK_TO                 = 0x5000,
+  QK_TO_MAX             = 0x50FF,
+  QK_MOMENTARY          = 0x5100,
+  QK_MOMENTARY_MAX      = 0x51FF,
+  QK_DEF_LAYER          = 0x5200,
+  QK_DEF_LAYER_MAX      = 0x52FF,
+  QK_TOGGLE_LAYER       = 0x5300,
+  QK_TOGGLE_LAYER_MAX   = 0x53FF,
+  QK_ONE_SHOT_LAYER     = 0x5400,
+  QK_ONE_SHOT_LAYER_MAX = 0x54FF,
+  QK_ONE_SHOT_MOD       = 0x5500,
+  QK_ONE_SHOT_MOD_MAX   = 0x55FF,
+  QK_TAP_DANCE          = 0x5700,
+  QK_TAP_DANCE_MAX      = 0x57FF,
+  QK_LAYER_TAP_TOGGLE   = 0x5800,
+  QK_LAYER_TAP_TOGGLE_MAX = 0x58FF,
+  QK_MOD_TAP            = 0x6000,
+  QK_MOD_TAP_MAX        = 0x7FFF,
+
+  RESET = 0x5C00,
+  DEBUG,
+  KC_LEAD,
+  KC_LSPO,
+  KC_RSPC,
+  RGB_TOG,
+  RGB_MOD,
+  RGB_HUI,
+  RGB_HUD,
+  RGB_SAI,
+  RGB_SAD,
+  RGB_VAI,
+  RGB_VAD,
+
+  SAFE_RANGE
+};
+
+#define LCTL(kc) ((kc) | QK_LCTL)
+#define LSFT(kc) ((kc) | QK_LSFT)
+#define LALT(kc) ((kc) | QK_LALT)
+#define LGUI(kc) ((kc) | QK_LGUI)
+#define RCTL(kc) ((kc) | QK_RCTL)
+#define RSFT(kc) ((kc) | QK_RSFT)
+#define RALT(kc) ((kc) | QK_RALT)
+#define RGUI(kc) ((kc) | QK_RGUI)
+#define S(kc) LSFT(kc)
+
+#define KC_TILD LSFT(KC_GRV)
+#define KC_EXLM LSFT(KC_1)
+#define KC_AT   LSFT(KC_2)
+#define KC_HASH LSFT(KC_3)
+#define KC_DLR  LSFT(KC_4)
+#define KC_PERC LSFT(KC_5)
+#define KC_CIRC LSFT(KC_6)
+#define KC_AMPR LSFT(KC_7)
+#define KC_ASTR LSFT(KC_8)
+#define KC_LPRN LSFT(KC_9)
+#define KC_RPRN LSFT(KC_0)
+#define KC_UNDS LSFT(KC_MINS)
+#define KC_PLUS LSFT(KC_EQL)
+#define KC_LCBR LSFT(KC_LBRC)
+#define KC_RCBR LSFT(KC_RBRC)
+#define KC_PIPE LSFT(KC_BSLS)
+#define KC_COLN LSFT(KC_SCLN)
+#define KC_DQT  LSFT(KC_QUOT)
+#define KC_DQUO KC_DQT
+#define KC_LT   LSFT(KC_COMM)
+#define KC_GT   LSFT(KC_DOT)
+#define KC_QUES LSFT(KC_SLSH)
+
+#define F(kc) ((kc) | QK_FUNCTION)
+#define M(kc) ((kc) | QK_MACRO)
+#define LT(layer, kc) ((kc) | QK_LAYER_TAP | (((layer) & 0xF) << 8))
+#define TO(layer) ((layer) | QK_TO)
+#define MO(layer) ((layer) | QK_MOMENTARY)
+#define DF(layer) ((layer) | QK_DEF_LAYER)
+#define TG(layer) ((layer) | QK_TOGGLE_LAYER)
+#define OSL(layer) ((layer) | QK_ONE_SHOT_LAYER)
+#define OSM(mod) ((mod) | QK_ONE_SHOT_MOD)
+#define TD(n) ((n) | QK_TAP_DANCE)
+#define TT(layer) ((layer) | QK_LAYER_TAP_TOGGLE)
+#define MT(mod, kc) ((kc) | QK_MOD_TAP | (((mod) & 0x1F) << 8))
+#define CTL_T(kc) MT(MOD_LCTL, kc)
+#define SFT_T(kc) MT(MOD_LSFT, kc)
+#define ALT_T(kc) MT(MOD_LALT, kc)
+#define GUI_T(kc) MT(MOD_LGUI, kc)
+#define ALL_T(kc) MT(MOD_HYPR, kc)
+#define MEH_T(kc) MT(MOD_MEH, kc)
+
+// action.h
+typedef struct {
+  uint8_t col;
+  uint8_t row;
+} keypos_t;
+
+typedef struct {
+  keypos_t key;
+  bool     pressed;
+  uint16_t time;
+} keyevent_t;
+
+typedef struct {
+  bool    interrupted :1;
+  bool    reserved2   :1;
+  bool    reserved1   :1;
+  bool    reserved0   :1;
+  uint8_t count       :4;
+} tap_t;
+
+typedef struct {
+  keyevent_t event;
+  tap_t tap;
+} keyrecord_t;
+
+#define ACTION_LAYER_TAP_TOGGLE(layer) (0xA000 | ((layer) << 8) | 0xF0)
+
+bool process_record_user(uint16_t keycode, keyrecord_t *record);
+void matrix_init_user(void);
+void matrix_scan_user(void);
+
+// keymap.h; keymap_common.c's version is weak so a keymap can replace it
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key);
+
+// action_layer.h
+extern uint32_t layer_state;
+extern uint32_t default_layer_state;
+void layer_clear(void);
+void layer_move(uint8_t layer);
+void layer_on(uint8_t layer);
+void layer_off(uint8_t layer);
+void layer_invert(uint8_t layer);
+void layer_state_set(uint32_t state);
+uint8_t biton32(uint32_t bits);
+
+// action_macro.h
+typedef uint8_t macro_t;
+
+enum macro_command_id {
+  END = 0x00,
+  KEY_DOWN,
+  KEY_UP,
+  WAIT = 0x74,
+  INTERVAL
+};
+
+#define MACRO_NONE 0
+#define MACRO(...) ({ static const macro_t __m[] PROGMEM = { __VA_ARGS__ }; &__m[0]; })
+#define DOWN(key) KEY_DOWN, (key)
+#define UP(key) KEY_UP, (key)
+#define TYPE(key) DOWN(key), UP(key)
+#define WAIT(ms) WAIT, (ms)
+#define D(key) DOWN(KC_##key)
+#define U(key) UP(KC_##key)
+#define T(key) TYPE(KC_##key)
+#define W(ms) WAIT(ms)
+#define I(ms) INTERVAL, (ms)
+
+const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt);
+void action_macro_play(const macro_t *macro_p);
+
+// action_util.h / action.h
+uint8_t get_mods(void);
+void add_mods(uint8_t mods);
+void del_mods(uint8_t mods);
+void set_mods(uint8_t mods);
+void clear_mods(void);
+void add_key(uint8_t key);
+void del_key(uint8_t key);
+void clear_keys(void);
+void send_keyboard_report(void);
+void register_code(uint8_t code);
+void unregister_code(uint8_t code);
+void register_mods(uint8_t mods);
+void unregister_mods(uint8_t mods);
+void clear_keyboard(void);
+
+// One-shot layer state, as in action_util.h: the bits still to happen
+// before the layer turns off again
+typedef enum {
+  ONESHOT_PRESSED = 0b01,
+  ONESHOT_OTHER_KEY_PRESSED = 0b10,
+  ONESHOT_START = 0b11,
+  ONESHOT_TOGGLED = 0b100
+} oneshot_fullfillment_t;
+
+uint8_t get_oneshot_layer(void);
+uint8_t get_oneshot_layer_state(void);
+void clear_oneshot_layer_state(oneshot_fullfillment_t state);
+
+// quantum.h
+extern const bool ascii_to_shift_lut[0x80];
+extern const uint8_t ascii_to_keycode_lut[0x80];
+void send_string(const char *str);
+#define SEND_STRING(str) send_string(PSTR(str))
+
+// host.h / led.h
+#define USB_LED_NUM_LOCK 0
+#define USB_LED_CAPS_LOCK 1
+#define USB_LED_SCROLL_LOCK 2
+
+extern uint8_t host_leds;
+uint8_t host_keyboard_leds(void);
+
+// report.h
+typedef union {
+  uint8_t raw[8];
+  struct {
+    uint8_t mods;
+    uint8_t reserved;
+    uint8_t keys[6];
+  };
+} report_keyboard_t;
+
+// action_util.h: the report being built, mods as of the last send
+extern report_keyboard_t *keyboard_report;
+
+#define MOUSE_BTN1 (1 << 0)
+#define MOUSE_BTN2 (1 << 1)
+#define MOUSE_BTN3 (1 << 2)
+#define MOUSE_BTN4 (1 << 3)
+#define MOUSE_BTN5 (1 << 4)
+
+typedef struct {
+  uint8_t buttons;
+  int8_t x;
+  int8_t y;
+  int8_t v;
+  int8_t h;
+} report_mouse_t;
+
+void host_mouse_send(report_mouse_t *report);
+
+// timer.h / wait.h
+uint16_t timer_read(void);
+uint32_t timer_read32(void);
+uint16_t timer_elapsed(uint16_t last);
+uint32_t timer_elapsed32(uint32_t last);
+void wait_ms(uint16_t ms);
+
+// eeconfig.h
+void eeconfig_init(void);
+
+// eeprom.h (avr/eeprom.h on AVR)
+uint8_t eeprom_read_byte(const uint8_t *addr);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+void eeprom_read_block(void *buf, const void *addr, size_t len);
+void eeprom_update_block(const void *buf, void *addr, size_t len);
+
+// raw_hid.h
+void raw_hid_receive(uint8_t *data, uint8_t length);
+void raw_hid_send(uint8_t *data, uint8_t length);
+
+// process_leader.h
+void leader_start(void);
+void leader_end(void);
+
+#define SEQ_ONE_KEY(key) if (leader_sequence[0] == (key) && leader_sequence[1] == 0 && leader_sequence[2] == 0 && leader_sequence[3] == 0 && leader_sequence[4] == 0)
+#define SEQ_TWO_KEYS(key1, key2) if (leader_sequence[0] == (key1) && leader_sequence[1] == (key2) && leader_sequence[2] == 0 && leader_sequence[3] == 0 && leader_sequence[4] == 0)
+#define SEQ_THREE_KEYS(key1, key2, key3) if (leader_sequence[0] == (key1) && leader_sequence[1] == (key2) && leader_sequence[2] == (key3) && leader_sequence[3] == 0 && leader_sequence[4] == 0)
+#define SEQ_FOUR_KEYS(key1, key2, key3, key4) if (leader_sequence[0] == (key1) && leader_sequence[1] == (key2) && leader_sequence[2] == (key3) && leader_sequence[3] == (key4) && leader_sequence[4] == 0)
+#define SEQ_FIVE_KEYS(key1, key2, key3, key4, key5) if (leader_sequence[0] == (key1) && leader_sequence[1] == (key2) && leader_sequence[2] == (key3) && leader_sequence[3] == (key4) && leader_sequence[4] == (key5))
+
+#define LEADER_EXTERNS() extern bool leading; extern uint16_t leader_time; extern uint16_t leader_sequence[5]; extern uint8_t leader_sequence_size
+#define LEADER_DICTIONARY() if (leading && timer_elapsed(leader_time) > LEADER_TIMEOUT)
+
+// ergodox_ez.h
+#define LED_BRIGHTNESS_LO 15
+#define LED_BRIGHTNESS_HI 255
+
+void ergodox_board_led_on(void);
+void ergodox_board_led_off(void);
+void ergodox_right_led_1_on(void);
+void ergodox_right_led_1_off(void);
+void ergodox_right_led_2_on(void);
+void ergodox_right_led_2_off(void);
+void ergodox_right_led_3_on(void);
+void ergodox_right_led_3_off(void);
+void ergodox_right_led_on(uint8_t led);
+void ergodox_right_led_off(uint8_t led);
+void ergodox_led_all_on(void);
+void ergodox_led_all_off(void);
+void ergodox_right_led_1_set(uint8_t n);
+void ergodox_right_led_2_set(uint8_t n);
+void ergodox_right_led_3_set(uint8_t n);
+void ergodox_right_led_set(uint8_t led, uint8_t n);
+void ergodox_led_all_set(uint8_t n);
+
+#define KEYMAP(                                                 \
+    /* left hand, spatial positions */                          \
+    k00,k01,k02,k03,k04,k05,k06,                                \
+    k10,k11,k12,k13,k14,k15,k16,                                \
+    k20,k21,k22,k23,k24,k25,                                    \
+    k30,k31,k32,k33,k34,k35,k36,                                \
+    k40,k41,k42,k43,k44,                                        \
+                            k55,k56,                            \
+                                k54,                            \
+                        k53,k52,k51,                            \
+                                                                \
+    /* right hand, spatial positions */                         \
+        k07,k08,k09,k0A,k0B,k0C,k0D,                            \
+        k17,k18,k19,k1A,k1B,k1C,k1D,                            \
+            k28,k29,k2A,k2B,k2C,k2D,                            \
+        k37,k38,k39,k3A,k3B,k3C,k3D,                            \
+                k49,k4A,k4B,k4C,k4D,                            \
+    k57,k58,                                                    \
+    k59,                                                        \
+    k5C,k5B,k5A )                                               \
+                                                                \
+   /* matrix positions */                                       \
+   {                                                            \
+    { k00, k10, k20, k30, k40, KC_NO },                         \
+    { k01, k11, k21, k31, k41, k51 },                           \
+    { k02, k12, k22, k32, k42, k52 },                           \
+    { k03, k13, k23, k33, k43, k53 },                           \
+    { k04, k14, k24, k34, k44, k54 },                           \
+    { k05, k15, k25, k35, KC_NO, k55 },                         \
+    { k06, k16, KC_NO, k36, KC_NO, k56 },                       \
+                                                                \
+    { k07, k17, KC_NO, k37, KC_NO, k57 },                       \
+    { k08, k18, k28, k38, KC_NO, k58 },                         \
+    { k09, k19, k29, k39, k49, k59 },                           \
+    { k0A, k1A, k2A, k3A, k4A, k5A },                           \
+    { k0B, k1B, k2B, k3B, k4B, k5B },                           \
+    { k0C, k1C, k2C, k3C, k4C, k5C },                           \
+    { k0D, k1D, k2D, k3D, k4D, KC_NO }                          \
+   }
+
+// debug.h
+#define dprint(s)
+#define dprintf(fmt, ...)
+#define print(s)
+#define xprintf(fmt, ...)
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SIM_RAW_HID_H
+#define SIM_RAW_HID_H
+
+#include "qmk.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SIM_VERSION_H
+#define SIM_VERSION_H
+
+#include "qmk.h"
+
+#endif
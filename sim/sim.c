@@ -0,0 +1,423 @@
+/* ambi-sim: replay a timestamped key trace through keymap.c on the host.
+ *
+ * Trace format, one edge per line, '#' starts a comment:
+ *
+ *   <time ms> <d|u> <matrix row> <matrix col>
+ *
+ * Rows/cols are matrix positions (14x6 on the Ergodox, see KEYMAP() in
+ * qmk/qmk.h), so LCtrl/{ on the home row is "0 2" and RShift/) is "13 3".
+ * Times are absolute from power-up; matrix_init_user runs at t=0.
+ *
+ * A line holding "ambt1 <hex>", as typed by the Trace key (see TRACE
+ * RECORDER in keymap.c), is replayed too: its events start a second after
+ * the previous edge (or at 3000 ms) and keep their recorded spacing. Each
+ * record the keymap then sees is checked against the recorded keycode and
+ * layer state, and differences are logged as "replay" lines.
+ *
+ * With RAW_ENABLE, a line
+ *
+ *   <time ms> hid <hex bytes>
+ *
+ * hands a raw HID packet, zero padded to OVERLAY_HID_SIZE, to
+ * raw_hid_receive as the host would; it and the keymap's reply are logged
+ * as "rawhid" lines. Bytes may be separated by spaces.
+ *
+ * The virtual clock advances 1 ms per scan, running matrix_scan_user and
+ * then any edges that are due, debounced as the Makefile's DEBOUNCE_TYPE
+ * and DEBOUNCE say, so a trace can include contact bounce. Output is one
+ * line per record, HID report, layer change and LED change, followed by
+ * per-hook timing. Scans are only logged when matrix_scan_user did
+ * something visible.
+ *
+ * The summary ends with the text the host would have seen typed, so
+ * strings the keymap types (VRSN, the Stats key) can be piped onward.
+ *
+ * EEPROM starts erased, or from the image given with -e, which is written
+ * back on exit so learned settings carry over to the next run.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+
+#define RAW_HID_SIZE 32 // QMK's RAW_EPSIZE
+
+typedef struct {
+  uint32_t time;
+  uint8_t row;
+  uint8_t col;
+  bool pressed;
+} trace_event_t;
+
+typedef struct {
+  uint8_t pos; // row << 4 | col << 1 | pressed
+  uint8_t layers;
+  uint16_t keycode;
+} recorded_t;
+
+typedef struct {
+  uint32_t time;
+  uint8_t data[RAW_HID_SIZE];
+} raw_hid_packet_t;
+
+static trace_event_t *events;
+static size_t event_count;
+static size_t event_capacity;
+static bool matrix[MATRIX_ROWS][MATRIX_COLS];    // raw, as last scanned
+static bool debounced[MATRIX_ROWS][MATRIX_COLS]; // as handed to the keymap
+static uint32_t raw_since[MATRIX_ROWS][MATRIX_COLS]; // raw last moved away from debounced
+static uint32_t matrix_quiet_since; // last raw change anywhere, for sym_defer
+#ifdef DEBOUNCE_EAGER_PK
+static uint32_t locked_until[MATRIX_ROWS][MATRIX_COLS];
+#endif
+
+static raw_hid_packet_t *packets;
+static size_t packet_count;
+static uint32_t trace_end; // time of the last line
+
+static recorded_t *recorded;
+static size_t recorded_count;
+static size_t recorded_next; // next record process_record_user should see
+static uint32_t replay_start = UINT32_MAX;
+static unsigned replay_mismatches;
+
+static void add_event(trace_event_t event) {
+  if (event_count == event_capacity) {
+    event_capacity = event_capacity ? event_capacity * 2 : 64;
+    events = realloc(events, event_capacity * sizeof(*events));
+  }
+  events[event_count++] = event;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// "ambt1 " followed by 6 bytes per event, see the comment at the top
+static void load_recording(const char *hex, const char *name, unsigned lineno) {
+  uint32_t time = event_count ? events[event_count - 1].time + 1000 : 3000;
+  uint16_t last = 0;
+  bool first = true;
+
+  while (hex_digit(hex[0]) >= 0) {
+    uint8_t bytes[6];
+    uint16_t stamp;
+    int i;
+    for (i = 0; i < 6; i++) {
+      int high = hex_digit(hex[2 * i]);
+      int low = high < 0 ? -1 : hex_digit(hex[2 * i + 1]);
+      if (low < 0) {
+        fprintf(stderr, "%s:%u: recording ends mid-event\n", name, lineno);
+        exit(1);
+      }
+      bytes[i] = high << 4 | low;
+    }
+    hex += 12;
+    stamp = bytes[0] | bytes[1] << 8;
+    time += first ? 0 : (uint16_t)(stamp - last);
+    last = stamp;
+    if (first) {
+      replay_start = replay_start < time ? replay_start : time;
+      first = false;
+    }
+    if ((bytes[2] >> 4) >= MATRIX_ROWS || ((bytes[2] >> 1) & 7) >= MATRIX_COLS) {
+      fprintf(stderr, "%s:%u: recorded key outside the matrix\n", name, lineno);
+      exit(1);
+    }
+    add_event((trace_event_t){ time, bytes[2] >> 4, (bytes[2] >> 1) & 7, bytes[2] & 1 });
+    trace_end = time;
+    recorded = realloc(recorded, (recorded_count + 1) * sizeof(*recorded));
+    recorded[recorded_count++] = (recorded_t){ bytes[2], bytes[3], bytes[4] | bytes[5] << 8 };
+  }
+}
+
+void sim_record_seen(keyrecord_t *record, uint16_t keycode) {
+  uint8_t pos = record->event.key.row << 4 | record->event.key.col << 1 | record->event.pressed;
+  const recorded_t *expect;
+
+  if (sim_now < replay_start || recorded_next == recorded_count) {
+    return;
+  }
+  expect = &recorded[recorded_next++];
+  if (expect->pos != pos || expect->keycode != keycode || expect->layers != (uint8_t)layer_state) {
+    sim_log("replay  record %zu: recorded [%2u,%u] %s kc=0x%04X layers=0x%02X",
+            recorded_next, expect->pos >> 4, (expect->pos >> 1) & 7,
+            expect->pos & 1 ? "press" : "release", expect->keycode, expect->layers);
+    replay_mismatches++;
+  }
+}
+
+static void check_time(uint32_t time, const char *name, unsigned lineno) {
+  if (time < trace_end) {
+    fprintf(stderr, "%s:%u: time goes backwards\n", name, lineno);
+    exit(1);
+  }
+  trace_end = time;
+}
+
+static void load_packet(uint32_t time, const char *hex, const char *name, unsigned lineno) {
+  raw_hid_packet_t packet = { time, { 0 } };
+  size_t len = 0;
+
+#ifndef RAW_ENABLE
+  fprintf(stderr, "%s:%u: raw HID needs RAW_ENABLE = yes in the Makefile\n", name, lineno);
+  exit(1);
+#endif
+  check_time(time, name, lineno);
+  while (*(hex += strspn(hex, " \t")) && !strchr("\r\n", *hex)) {
+    int high = hex_digit(hex[0]);
+    int low = high < 0 ? -1 : hex_digit(hex[1]);
+    if (low < 0 || len == RAW_HID_SIZE) {
+      fprintf(stderr, "%s:%u: expected up to %d hex bytes\n", name, lineno, RAW_HID_SIZE);
+      exit(1);
+    }
+    packet.data[len++] = high << 4 | low;
+    hex += 2;
+  }
+  packets = realloc(packets, (packet_count + 1) * sizeof(*packets));
+  packets[packet_count++] = packet;
+}
+
+static void load_trace(FILE *in, const char *name) {
+  char line[4096];
+  unsigned lineno = 0;
+
+  while (fgets(line, sizeof(line), in)) {
+    unsigned time, row, col;
+    int hex = 0;
+    char edge;
+    char *comment = strchr(line, '#');
+    char *recording = strstr(line, "ambt1 ");
+
+    lineno++;
+    if (recording) {
+      load_recording(recording + strlen("ambt1 "), name, lineno);
+      continue;
+    }
+    if (comment) {
+      *comment = '\0';
+    }
+    if (strspn(line, " \t\r\n") == strlen(line)) {
+      continue;
+    }
+    if (sscanf(line, "%u hid %n", &time, &hex) == 1 && hex) {
+      load_packet(time, line + hex, name, lineno);
+      continue;
+    }
+    if (sscanf(line, "%u %c %u %u", &time, &edge, &row, &col) != 4 ||
+        (edge != 'd' && edge != 'u') || row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+      fprintf(stderr, "%s:%u: expected '<ms> <d|u> <row> <col>'\n", name, lineno);
+      exit(1);
+    }
+    check_time(time, name, lineno);
+    add_event((trace_event_t){ time, row, col, edge == 'd' });
+  }
+}
+
+// Hand raw changes to the keymap as the Makefile's DEBOUNCE_TYPE would.
+// sym_defer waits until no key has changed for DEBOUNCE ms; eager_pk passes
+// a key's first edge on at once and then ignores that key for DEBOUNCE ms,
+// after which any difference left (a bounce that settled the other way) is
+// passed on like a new edge.
+static void debounce_matrix(void) {
+  uint8_t row, col;
+
+  for (row = 0; row < MATRIX_ROWS; row++) {
+    for (col = 0; col < MATRIX_COLS; col++) {
+      if (matrix[row][col] == debounced[row][col]) {
+        continue;
+      }
+#ifdef DEBOUNCE_EAGER_PK
+      if (sim_now < locked_until[row][col]) {
+        continue;
+      }
+      locked_until[row][col] = sim_now + DEBOUNCE;
+#else
+      if (sim_now - matrix_quiet_since < DEBOUNCE) {
+        continue;
+      }
+#endif
+      debounced[row][col] = matrix[row][col];
+      sim_timing_add(&sim_stats.debounce, (uint64_t)(sim_now - raw_since[row][col]) * 1000000);
+      sim_key_event(row, col, matrix[row][col], sim_now);
+    }
+  }
+}
+
+// Scan every edge that is due, then debounce. Like a real scan, only the
+// net state per key is visible: a press and release that both land while
+// the firmware was blocked (wait_ms) never reach the keymap.
+static size_t deliver_events(size_t next) {
+  size_t end = next;
+  size_t i, j;
+
+  while (end < event_count && events[end].time <= sim_now) {
+    end++;
+  }
+  for (i = next; i < end; i++) {
+    trace_event_t *ev = &events[i];
+    unsigned edges = 1;
+    bool last = true;
+    for (j = next; j < end; j++) {
+      if (j != i && events[j].row == ev->row && events[j].col == ev->col) {
+        last &= j < i;
+        edges++;
+      }
+    }
+    if (!last) {
+      continue;
+    }
+    if (matrix[ev->row][ev->col] == ev->pressed) {
+      sim_log("lost    [%2u,%u] %u edges while the firmware was blocked", ev->row, ev->col, edges);
+      sim_stats.lost_events += edges;
+      continue;
+    }
+    if (sim_now - ev->time > 1) {
+      sim_log("late    [%2u,%u] edge from %u delivered %u ms late", ev->row, ev->col, ev->time, sim_now - ev->time);
+    }
+    if (matrix[ev->row][ev->col] == debounced[ev->row][ev->col]) {
+      raw_since[ev->row][ev->col] = ev->time;
+    }
+    matrix[ev->row][ev->col] = ev->pressed;
+    matrix_quiet_since = sim_now;
+  }
+  debounce_matrix();
+  return end;
+}
+
+// Packets that are due go to raw_hid_receive, as the USB task would
+static size_t deliver_packets(size_t next) {
+  for (; next < packet_count && packets[next].time <= sim_now; next++) {
+    sim_raw_hid_log("got ", packets[next].data, RAW_HID_SIZE);
+#ifdef RAW_ENABLE
+    raw_hid_receive(packets[next].data, RAW_HID_SIZE);
+#endif
+  }
+  return next;
+}
+
+static void print_timing(const char *name, const sim_timing_t *timing) {
+  printf("  %-20s %8u calls  avg %8.1f ns  max %8llu ns\n", name, timing->count,
+         timing->count ? (double)timing->total_ns / timing->count : 0.0,
+         (unsigned long long)timing->max_ns);
+}
+
+static void load_eeprom(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f) {
+    if (fread(sim_eeprom, 1, sizeof(sim_eeprom), f) != sizeof(sim_eeprom)) {
+      fprintf(stderr, "%s: short EEPROM image, rest left erased\n", path);
+    }
+    fclose(f);
+  }
+}
+
+static void save_eeprom(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f || fwrite(sim_eeprom, 1, sizeof(sim_eeprom), f) != sizeof(sim_eeprom)) {
+    perror(path);
+    exit(1);
+  }
+  fclose(f);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-v] [-q] [-e eeprom.bin] [trace]\n"
+                  "  -v  log LED brightness steps as well as on/off\n"
+                  "  -q  only print the timing summary\n"
+                  "  -e  load EEPROM from this image and save it back on exit\n"
+                  "  trace defaults to stdin\n", argv0);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  bool quiet = false;
+  FILE *in = stdin;
+  const char *name = "<stdin>";
+  const char *eeprom = NULL;
+  uint32_t end, ready;
+  size_t next = 0, next_packet = 0;
+  uint64_t start;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vqe:")) != -1) {
+    switch (opt) {
+      case 'v': sim_verbose = true; break;
+      case 'q': quiet = true; break;
+      case 'e': eeprom = optarg; break;
+      default: usage(argv[0]);
+    }
+  }
+  if (optind < argc) {
+    name = argv[optind];
+    if (!(in = fopen(name, "r"))) {
+      perror(name);
+      return 1;
+    }
+  }
+  load_trace(in, name);
+  memset(sim_eeprom, 0xFF, sizeof(sim_eeprom));
+  if (eeprom) {
+    load_eeprom(eeprom);
+  }
+
+  sim_overhead_ns = 0;
+  start = sim_clock_ns();
+  matrix_init_user();
+  sim_timing_add(&sim_stats.init, sim_clock_ns() - start - sim_overhead_ns);
+  ready = sim_now;
+  sim_log("ready   matrix_init_user blocked for %u ms", ready);
+
+  end = (trace_end > ready ? trace_end : ready) + LEADER_TIMEOUT + TAPPING_TERM + 50;
+  for (; sim_now <= end; sim_now++) {
+    size_t mark = sim_log_mark();
+    sim_overhead_ns = 0;
+    start = sim_clock_ns();
+    matrix_scan_user();
+    start = sim_clock_ns() - start - sim_overhead_ns;
+    sim_timing_add(&sim_stats.scan, start);
+    if (sim_log_mark() != mark) {
+      sim_log_at(mark, "scan    user=%lluns", (unsigned long long)start);
+    }
+    next = deliver_events(next);
+    next_packet = deliver_packets(next_packet);
+    sim_tick();
+    if (quiet) {
+      sim_reset_log();
+    } else {
+      sim_flush();
+    }
+  }
+
+  printf("\nsummary (%zu trace events, %u ms simulated)\n", event_count, sim_now);
+  print_timing("matrix_init_user", &sim_stats.init);
+  print_timing("process_record_user", &sim_stats.record);
+  print_timing("matrix_scan_user", &sim_stats.scan);
+  printf("  %-20s %8u keys  avg %8.1f ms  max %8llu ms\n", "debounce delay",
+         sim_stats.debounce.count,
+         sim_stats.debounce.count ? sim_stats.debounce.total_ns / 1e6 / sim_stats.debounce.count : 0.0,
+         (unsigned long long)(sim_stats.debounce.max_ns / 1000000));
+  printf("  %-20s %8u ms\n", "blocked in wait_ms", sim_stats.blocked_ms);
+  printf("  %-20s %8u\n", "keyboard reports", sim_stats.reports);
+  if (sim_stats.mouse_reports) {
+    printf("  %-20s %8u (pointer moved %d, %d)\n", "mouse reports", sim_stats.mouse_reports,
+           sim_stats.mouse_x, sim_stats.mouse_y);
+  }
+  printf("  %-20s %8u\n", "LED calls", sim_stats.led_calls);
+  printf("  %-20s %8u\n", "lost edges", sim_stats.lost_events);
+  printf("  %-20s %8u\n", "EEPROM bytes written", sim_stats.eeprom_writes);
+  if (recorded_count) {
+    printf("  %-20s %8u of %zu (%zu replayed)\n", "replay mismatches", replay_mismatches,
+           recorded_count, recorded_next);
+  }
+  if (sim_typed[0]) {
+    printf("\ntyped\n%s%s", sim_typed, sim_typed[strlen(sim_typed) - 1] == '\n' ? "" : "\n");
+  }
+  if (eeprom) {
+    save_eeprom(eeprom);
+  }
+  return 0;
+}
@@ -0,0 +1,61 @@
+/* Glue between the stub QMK core (qmk.c) and the trace driver (sim.c). */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "qmk.h"
+
+typedef struct {
+  uint32_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+} sim_timing_t;
+
+typedef struct {
+  sim_timing_t init;       // matrix_init_user
+  sim_timing_t record;     // process_record_user
+  sim_timing_t scan;       // matrix_scan_user
+  sim_timing_t debounce;   // edge to debounced key, in whole ms
+  uint32_t blocked_ms;     // time spent inside wait_ms
+  uint32_t reports;        // keyboard reports sent
+  uint32_t mouse_reports;  // mouse reports sent
+  int32_t mouse_x;         // sum of the mouse reports' motion
+  int32_t mouse_y;
+  uint32_t led_calls;      // ergodox_*led* calls
+  uint32_t lost_events;    // edges the matrix never saw
+  uint32_t eeprom_writes;  // EEPROM cells actually rewritten
+} sim_stats_t;
+
+extern uint32_t sim_now;    // virtual ms clock behind timer_read()
+extern bool sim_verbose;
+extern sim_stats_t sim_stats;
+extern const uint8_t sim_keymap_layers;
+// Text the host would have received, reconstructed from keyboard reports
+#define SIM_TYPED_SIZE 4096
+extern char sim_typed[SIM_TYPED_SIZE];
+#define SIM_EEPROM_SIZE 1024
+extern uint8_t sim_eeprom[SIM_EEPROM_SIZE];
+// Time spent logging inside the stubs; subtracted from hook timings
+extern uint64_t sim_overhead_ns;
+
+uint64_t sim_clock_ns(void);
+void sim_timing_add(sim_timing_t *timing, uint64_t ns);
+
+void sim_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+size_t sim_log_mark(void);
+void sim_log_at(size_t mark, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void sim_flush(void);
+void sim_reset_log(void);
+void sim_raw_hid_log(const char *what, const uint8_t *data, uint8_t length);
+
+// Feed one debounced matrix edge into the action pipeline
+void sim_key_event(uint8_t row, uint8_t col, bool pressed, uint32_t time);
+// Per-scan housekeeping (tapping term expiry)
+void sim_tick(void);
+// Called by the stub core with every record process_record_user sees;
+// checks it against a replayed recording
+void sim_record_seen(keyrecord_t *record, uint16_t keycode);
+
+#endif
@@ -0,0 +1,169 @@
+/* sparse_layers: build ../sparse_layers.h from ../sparse_layers.def.
+ *
+ * Every layer in sparse_layers.def is expanded with KEYMAP(), exactly as a
+ * dense layer would be, and then packed: per matrix row, a bit for each
+ * col that isn't KC_TRNS and the index of that row's first keycode in one
+ * shared sparse_keys[] array holding only the non-transparent keycodes.
+ * Positions KEYMAP() pads with KC_NO because the board has no key there
+ * are treated as transparent.
+ *
+ * Keycode values come from the stub headers in qmk/ and from
+ * custom_keycodes.h; the emitted header uses the names from
+ * sparse_layers.def, not values.
+ *
+ * The header carries the cksum of sparse_layers.def it was built from,
+ * which keymap.c checks against the file at build time.
+ *
+ * Fails (exit 1) when a layer is declared twice or the packed keycodes no
+ * longer fit the 8 bit row index.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qmk.h"
+#include "def_cksum.h"
+#include "../layers.h"
+#include "../custom_keycodes.h"
+
+#define MAX_KEYS 255 // sparse_row_t.first is a byte
+#define MAX_NAME 32
+#define KEYMAP_KEYS 76
+
+typedef struct {
+  const char *name;
+  uint8_t layer;
+  uint16_t keys[MATRIX_ROWS][MATRIX_COLS];
+  const char *names; // "VRSN, KC_F1, ..." in KEYMAP() order
+} sparse_layer_t;
+
+static const sparse_layer_t layers[] = {
+#define SPARSE_LAYER(layer, ...) { #layer, layer, KEYMAP(__VA_ARGS__), #__VA_ARGS__ },
+#include "../sparse_layers.def"
+#undef SPARSE_LAYER
+};
+#define LAYER_DEF_COUNT (sizeof(layers) / sizeof(layers[0]))
+
+static const char *layer_names[] = {
+#define LAYER_NAME(name, leds, hue, text) #name,
+  LAYERS(LAYER_NAME)
+#undef LAYER_NAME
+};
+
+// KEYMAP() argument (from 1) behind each matrix position, 0 where it pads
+static const uint8_t key_args[MATRIX_ROWS][MATRIX_COLS] = KEYMAP(
+   1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+  20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38,
+  39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57,
+  58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76);
+
+static char key_names[LAYER_DEF_COUNT][KEYMAP_KEYS + 1][MAX_NAME];
+
+// Splits "LT(SYMB, KC_Z), KC_X" on the commas outside parentheses
+static void split_names(const char *names, char out[][MAX_NAME]) {
+  const char *p = names;
+  int arg;
+
+  for (arg = 1; arg <= KEYMAP_KEYS && *p; arg++) {
+    int depth = 0;
+    size_t len = 0;
+    p += strspn(p, " ");
+    while (*p && (depth || *p != ',')) {
+      depth += (*p == '(') - (*p == ')');
+      if (len < MAX_NAME - 1) {
+        out[arg][len++] = *p;
+      }
+      p++;
+    }
+    while (len && out[arg][len - 1] == ' ') {
+      len--;
+    }
+    out[arg][len] = '\0';
+    if (*p) {
+      p++;
+    }
+  }
+}
+
+static int kept(const sparse_layer_t *layer, int row, int col) {
+  return key_args[row][col] && layer->keys[row][col] != KC_TRNS;
+}
+
+int main(void) {
+  int slots[LAYER_COUNT];
+  int total = 0;
+  size_t l;
+  int i, row, col;
+
+  for (i = 0; i < LAYER_COUNT; i++) {
+    slots[i] = -1;
+  }
+  for (l = 0; l < LAYER_DEF_COUNT; l++) {
+    if (slots[layers[l].layer] >= 0) {
+      fprintf(stderr, "sparse_layers.def: %s is declared twice\n", layers[l].name);
+      return 1;
+    }
+    slots[layers[l].layer] = l;
+    split_names(layers[l].names, key_names[l]);
+    for (row = 0; row < MATRIX_ROWS; row++) {
+      for (col = 0; col < MATRIX_COLS; col++) {
+        total += kept(&layers[l], row, col);
+      }
+    }
+  }
+  if (total > MAX_KEYS) {
+    fprintf(stderr, "sparse_layers.def: %d keycodes, more than the %d a row index reaches\n",
+            total, MAX_KEYS);
+    return 1;
+  }
+
+  printf("// Generated by sim/sparse_layers from sparse_layers.def; do not edit.\n");
+  printf("// Regenerate with: make -C sim sparse_layers\n\n");
+  printf("#define SPARSE_LAYER_COUNT %zu\n", LAYER_DEF_COUNT);
+  printf("#define SPARSE_LAYER_DEF_CKSUM %lu\n\n", (unsigned long)def_cksum("../sparse_layers.def"));
+
+  printf("static const uint8_t PROGMEM sparse_slots[LAYER_COUNT] = {\n");
+  for (i = 0; i < LAYER_COUNT; i++) {
+    char name[MAX_NAME + 4];
+    snprintf(name, sizeof(name), "[%s]", layer_names[i]);
+    if (slots[i] >= 0) {
+      printf("  %-7s = %d,\n", name, slots[i]);
+    }
+    else {
+      printf("  %-7s = SPARSE_NONE,\n", name);
+    }
+  }
+  printf("};\n\n");
+
+  total = 0;
+  printf("static const sparse_row_t PROGMEM sparse_rows[][MATRIX_ROWS] = {\n");
+  for (l = 0; l < LAYER_DEF_COUNT; l++) {
+    printf("  { // %s\n", layers[l].name);
+    for (row = 0; row < MATRIX_ROWS; row++) {
+      int cols = 0;
+      for (col = 0; col < MATRIX_COLS; col++) {
+        cols |= kept(&layers[l], row, col) << col;
+      }
+      printf("    { 0x%02x, %3d },\n", cols, total);
+      total += __builtin_popcount(cols);
+    }
+    printf("  },\n");
+  }
+  printf("};\n\n");
+
+  printf("static const uint16_t PROGMEM sparse_keys[] = {\n");
+  for (l = 0; l < LAYER_DEF_COUNT; l++) {
+    for (row = 0; row < MATRIX_ROWS; row++) {
+      int line = 0;
+      for (col = 0; col < MATRIX_COLS; col++) {
+        if (kept(&layers[l], row, col)) {
+          printf("%s%s,", line++ ? " " : "  ", key_names[l][key_args[row][col]]);
+        }
+      }
+      if (line) {
+        printf(" // %s row %d\n", layers[l].name, row);
+      }
+    }
+  }
+  printf("};\n");
+  return 0;
+}
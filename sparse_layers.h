@@ -0,0 +1,95 @@
+// Generated by sim/sparse_layers from sparse_layers.def; do not edit.
+// Regenerate with: make -C sim sparse_layers
+
+#define SPARSE_LAYER_COUNT 3
+#define SPARSE_LAYER_DEF_CKSUM 839828557
+
+static const uint8_t PROGMEM sparse_slots[LAYER_COUNT] = {
+  [BASE]  = SPARSE_NONE,
+  [ALPH]  = SPARSE_NONE,
+  [MDIA]  = 1,
+  [SYMB]  = 0,
+  [NAV]   = 2,
+  [FN]    = SPARSE_NONE,
+};
+
+static const sparse_row_t PROGMEM sparse_rows[][MATRIX_ROWS] = {
+  { // SYMB
+    { 0x1b,   0 },
+    { 0x01,   4 },
+    { 0x1f,   5 },
+    { 0x1f,  10 },
+    { 0x3f,  15 },
+    { 0x27,  21 },
+    { 0x2b,  25 },
+    { 0x20,  29 },
+    { 0x2f,  30 },
+    { 0x0f,  35 },
+    { 0x1f,  39 },
+    { 0x1f,  44 },
+    { 0x1f,  49 },
+    { 0x03,  54 },
+  },
+  { // MDIA
+    { 0x00,  56 },
+    { 0x00,  56 },
+    { 0x10,  56 },
+    { 0x04,  57 },
+    { 0x0f,  58 },
+    { 0x04,  62 },
+    { 0x00,  63 },
+    { 0x00,  63 },
+    { 0x06,  63 },
+    { 0x07,  65 },
+    { 0x26,  68 },
+    { 0x00,  71 },
+    { 0x00,  71 },
+    { 0x00,  71 },
+  },
+  { // NAV
+    { 0x00,  71 },
+    { 0x00,  71 },
+    { 0x00,  71 },
+    { 0x04,  71 },
+    { 0x0f,  72 },
+    { 0x04,  76 },
+    { 0x00,  77 },
+    { 0x00,  77 },
+    { 0x06,  77 },
+    { 0x06,  79 },
+    { 0x26,  81 },
+    { 0x00,  84 },
+    { 0x00,  84 },
+    { 0x00,  84 },
+  },
+};
+
+static const uint16_t PROGMEM sparse_keys[] = {
+  VRSN, STAT, TRCE, EPRM, // SYMB row 0
+  KC_F1, // SYMB row 1
+  KC_F2, KC_PIPE, KC_COLN, KC_SCLN, OSL(ALPH), // SYMB row 2
+  KC_F3, KC_HASH, KC_DQT, KC_QUOT, KC_BSLS, // SYMB row 3
+  KC_F4, KC_EQL, KC_MINS, KC_UNDS, KC_SLSH, DM_PLAY, // SYMB row 4
+  KC_F5, KC_TILD, KC_GRV, RGB_MOD, // SYMB row 5
+  TUNE, TUNE_UP, TUNE_DN, DM_REC, // SYMB row 6
+  RGB_TOG, // SYMB row 7
+  KC_F6, KC_UP, KC_DOWN, KC_AMPR, RGB_SLD, // SYMB row 8
+  KC_F7, KC_7, KC_4, KC_1, // SYMB row 9
+  KC_F8, KC_8, KC_5, KC_2, KC_DOT, // SYMB row 10
+  KC_F9, KC_9, KC_6, KC_3, KC_0, // SYMB row 11
+  KC_F10, KC_ASTR, KC_PLUS, KC_BSLS, KC_EQL, // SYMB row 12
+  KC_F11, KC_F12, // SYMB row 13
+  OSL(SYMB), // MDIA row 2
+  KC_MPRV, // MDIA row 3
+  KC_MUTE, KC_VOLU, KC_MPLY, KC_VOLD, // MDIA row 4
+  KC_MNXT, // MDIA row 5
+  KC_BTN1, KC_MS_L, // MDIA row 8
+  KC_BTN3, KC_MS_U, KC_MS_D, // MDIA row 9
+  KC_BTN2, KC_MS_R, KC_WBAK, // MDIA row 10
+  KC_MPRV, // NAV row 3
+  KC_MUTE, KC_VOLU, KC_MPLY, KC_VOLD, // NAV row 4
+  KC_MNXT, // NAV row 5
+  KC_BTN2, KC_MS_L, // NAV row 8
+  KC_MS_U, KC_MS_D, // NAV row 9
+  KC_BTN1, KC_MS_R, KC_WBAK, // NAV row 10
+};
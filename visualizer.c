@@ -16,6 +16,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "simple_visualizer.h"
+#include "util.h"
+#include "layers.h"
+
+static const struct {
+    uint8_t hue;
+    const char* text;
+} layer_lcd[LAYER_COUNT] = {
+#define LAYER_LCD(name, leds, hue, text) [name] = { hue, text },
+    LAYERS(LAYER_LCD)
+#undef LAYER_LCD
+};
 
 // This function should be implemented by the keymap visualizer
 // Don't change anything else than state->target_lcd_color and state->layer_text as that's the only thing
@@ -27,16 +38,10 @@ static void get_visualizer_layer_and_color(visualizer_state_t* state) {
     if (state->status.leds & (1u << USB_LED_CAPS_LOCK)) {
         saturation = 255;
     }
-    if (state->status.layer & 0x4) {
-        state->target_lcd_color = LCD_COLOR(0, saturation, 0xFF);
-        state->layer_text = "Media & Mouse";
-    }
-    else if (state->status.layer & 0x2) {
-        state->target_lcd_color = LCD_COLOR(168, saturation, 0xFF);
-        state->layer_text = "Symbol";
-    }
-    else {
-        state->target_lcd_color = LCD_COLOR(84, saturation, 0xFF);
-        state->layer_text = "Default";
+    uint8_t layer = biton32(state->status.layer);
+    if (layer >= LAYER_COUNT) {
+        layer = BASE;
     }
+    state->target_lcd_color = LCD_COLOR(layer_lcd[layer].hue, saturation, 0xFF);
+    state->layer_text = layer_lcd[layer].text;
 }